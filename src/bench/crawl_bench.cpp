@@ -0,0 +1,429 @@
+// End-to-end crawl benchmark: serves a generated site from local HTTP
+// servers on loopback and runs the spider against it.
+// Usage: crawl_bench [config_file] [key=value...]
+//
+// Site keys (the rest are passed to the spider as config values):
+//   pages            number of pages (default 2000)
+//   hosts            number of hosts, one loopback port each (default 4)
+//   page_bytes       mean page size (default 20000)
+//   page_bytes_sigma spread of the log-normal page size (default 0.5)
+//   fanout           links per page (default 8)
+//   latency_ms       response delay per host, comma separated and repeated
+//                    over the hosts (default 0)
+//   duplicate_ratio  share of pages repeating another page's text (default 0.1)
+//   server_threads   threads serving the site (default 2)
+//   seed             seed for the generated site (default 1)
+//
+// crawl_delay_ms, crawl_depth, conditional_recrawl and checkpoint_interval
+// default to values suited to a one-off full crawl. The spider writes to
+// the database in the config file; use a scratch one.
+#include "../common/config_parser.h"
+#include "../spider/spider.h"
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/version.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace {
+
+struct SiteOptions {
+    size_t pages = 2000;
+    size_t hosts = 4;
+    size_t page_bytes = 20000;
+    double page_bytes_sigma = 0.5;
+    size_t fanout = 8;
+    std::vector<int> latency_ms{0};
+    double duplicate_ratio = 0.1;
+    unsigned seed = 1;
+};
+
+// Pages are generated on request from the page number and the seed, so
+// every fetch of a page returns the same document. Page n is served by
+// host n % hosts as /page/n. Pages link to their children in a tree of the
+// given fan-out, so every page is reachable from page 0, and leaves link
+// to random pages. Duplicate pages repeat the text of an earlier page with
+// a different footer.
+class Site {
+public:
+    explicit Site(const SiteOptions& options) : options_(options) {
+        std::mt19937 rng(options_.seed);
+        const char* syllables[] = {"ka", "lo", "mi", "ne", "ru", "sa", "ti", "vo",
+                                   "de", "fu", "gra", "ho", "ber", "zan", "qui", "tor"};
+        std::uniform_int_distribution<int> syllable(0, 15);
+        std::uniform_int_distribution<int> length(1, 4);
+        for (int i = 0; i < 4000; ++i) {
+            std::string word;
+            for (int n = length(rng); n > 0; --n) {
+                word += syllables[syllable(rng)];
+            }
+            vocabulary_.push_back(word);
+        }
+    }
+
+    void setPorts(const std::vector<unsigned short>& ports) { ports_ = ports; }
+
+    size_t hostOf(size_t page) const { return page % options_.hosts; }
+
+    std::string url(size_t page) const {
+        return "http://127.0.0.1:" + std::to_string(ports_[hostOf(page)]) + "/page/" + std::to_string(page);
+    }
+
+    std::chrono::milliseconds latency(size_t host) const {
+        return std::chrono::milliseconds(options_.latency_ms[host % options_.latency_ms.size()]);
+    }
+
+    // Render the page at target on host; false if there is no such page
+    bool render(size_t host, const std::string& target, std::string& body) const {
+        const std::string prefix = "/page/";
+        if (target.compare(0, prefix.size(), prefix) != 0) {
+            return false;
+        }
+        size_t page;
+        try {
+            size_t used = 0;
+            page = std::stoul(target.substr(prefix.size()), &used);
+            if (used != target.size() - prefix.size()) {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+        if (page >= options_.pages || hostOf(page) != host) {
+            return false;
+        }
+
+        std::mt19937 rng(pageSeed(page));
+        size_t text_page = page;
+        if (page > 0 && std::bernoulli_distribution(options_.duplicate_ratio)(rng)) {
+            text_page = std::uniform_int_distribution<size_t>(0, page - 1)(rng);
+        }
+
+        body = "<!DOCTYPE html>\n<html><head><title>Page " + std::to_string(text_page) +
+               "</title></head><body>\n<ul>\n";
+        for (size_t link : links(page, rng)) {
+            std::string href = hostOf(link) == host ? "/page/" + std::to_string(link) : url(link);
+            body += "<li><a href=\"" + href + "\">Related page</a></li>\n";
+        }
+        body += "</ul>\n";
+        appendText(text_page, body);
+        body += "<p>Generated page " + std::to_string(page) + "</p>\n</body></html>\n";
+        return true;
+    }
+
+private:
+    SiteOptions options_;
+    std::vector<unsigned short> ports_;
+    std::vector<std::string> vocabulary_;
+
+    uint32_t pageSeed(size_t page) const {
+        return static_cast<uint32_t>(page * 2654435761u) ^ options_.seed;
+    }
+
+    std::vector<size_t> links(size_t page, std::mt19937& rng) const {
+        std::vector<size_t> result;
+        for (size_t i = 1; i <= options_.fanout; ++i) {
+            size_t child = page * options_.fanout + i;
+            if (child < options_.pages) {
+                result.push_back(child);
+            }
+        }
+        std::uniform_int_distribution<size_t> any_page(0, options_.pages - 1);
+        while (result.size() < options_.fanout) {
+            result.push_back(any_page(rng));
+        }
+        return result;
+    }
+
+    // Paragraphs of random words up to a log-normal size around the mean
+    void appendText(size_t page, std::string& body) const {
+        std::mt19937 rng(pageSeed(page) ^ 0x5bd1e995u);
+        double sigma = options_.page_bytes_sigma;
+        double mu = std::log(static_cast<double>(std::max<size_t>(1, options_.page_bytes))) - sigma * sigma / 2;
+        size_t target = static_cast<size_t>(std::lognormal_distribution<double>(mu, sigma)(rng));
+        target = std::max<size_t>(target, 256);
+
+        std::uniform_int_distribution<size_t> word(0, vocabulary_.size() - 1);
+        size_t end = body.size() + target;
+        while (body.size() < end) {
+            body += "<p>";
+            for (int i = 0; i < 40; ++i) {
+                if (i > 0) {
+                    body += ' ';
+                }
+                body += vocabulary_[word(rng)];
+            }
+            body += ".</p>\n";
+        }
+    }
+};
+
+// Serves one connection: keep-alive request loop with the host's latency
+// added before each response
+class ServerSession : public std::enable_shared_from_this<ServerSession> {
+public:
+    ServerSession(tcp::socket socket, const Site& site, size_t host)
+        : stream_(std::move(socket))
+        , timer_(stream_.get_executor())
+        , site_(site)
+        , host_(host) {
+    }
+
+    void run() { read(); }
+
+private:
+    beast::tcp_stream stream_;
+    net::steady_timer timer_;
+    beast::flat_buffer buffer_;
+    http::request<http::string_body> request_;
+    http::response<http::string_body> response_;
+    const Site& site_;
+    size_t host_;
+
+    void read() {
+        request_ = {};
+        stream_.expires_after(std::chrono::seconds(30));
+        http::async_read(stream_, buffer_, request_,
+                         beast::bind_front_handler(&ServerSession::onRead, shared_from_this()));
+    }
+
+    void onRead(beast::error_code ec, std::size_t) {
+        if (ec) {
+            stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+            return;
+        }
+
+        response_ = {};
+        response_.version(request_.version());
+        response_.keep_alive(request_.keep_alive());
+        response_.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+        std::string body;
+        if (request_.method() == http::verb::get &&
+            site_.render(host_, std::string(request_.target()), body)) {
+            response_.result(http::status::ok);
+            response_.set(http::field::content_type, "text/html; charset=utf-8");
+            response_.body() = std::move(body);
+        } else {
+            response_.result(http::status::not_found);
+            response_.set(http::field::content_type, "text/plain");
+            response_.body() = "Not found\n";
+        }
+        response_.prepare_payload();
+
+        auto latency = site_.latency(host_);
+        if (latency.count() > 0) {
+            timer_.expires_after(latency);
+            timer_.async_wait(beast::bind_front_handler(&ServerSession::write, shared_from_this()));
+        } else {
+            write(beast::error_code());
+        }
+    }
+
+    void write(beast::error_code) {
+        http::async_write(stream_, response_,
+                          beast::bind_front_handler(&ServerSession::onWrite, shared_from_this()));
+    }
+
+    void onWrite(beast::error_code ec, std::size_t) {
+        if (ec || !response_.keep_alive()) {
+            stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+            return;
+        }
+        read();
+    }
+};
+
+class ServerListener : public std::enable_shared_from_this<ServerListener> {
+public:
+    ServerListener(net::io_context& ioc, const Site& site, size_t host)
+        : ioc_(ioc)
+        , acceptor_(ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0))
+        , site_(site)
+        , host_(host) {
+    }
+
+    unsigned short port() const { return acceptor_.local_endpoint().port(); }
+
+    void run() { accept(); }
+
+private:
+    net::io_context& ioc_;
+    tcp::acceptor acceptor_;
+    const Site& site_;
+    size_t host_;
+
+    void accept() {
+        acceptor_.async_accept(net::make_strand(ioc_),
+                               beast::bind_front_handler(&ServerListener::onAccept, shared_from_this()));
+    }
+
+    void onAccept(beast::error_code ec, tcp::socket socket) {
+        if (!ec) {
+            std::make_shared<ServerSession>(std::move(socket), site_, host_)->run();
+        }
+        accept();
+    }
+};
+
+std::vector<int> parseIntList(const std::string& value) {
+    std::vector<int> result;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        result.push_back(std::max(0, std::stoi(item)));
+    }
+    return result;
+}
+
+double seconds(size_t microseconds) {
+    return static_cast<double>(microseconds) / 1e6;
+}
+
+void printStage(const std::string& label, size_t total_us, size_t pages) {
+    std::cout << "  " << std::left << std::setw(8) << label << std::right << std::fixed
+              << std::setprecision(2) << std::setw(10) << seconds(total_us) << " s total"
+              << std::setprecision(3) << std::setw(10)
+              << (pages > 0 ? static_cast<double>(total_us) / pages / 1000.0 : 0.0) << " ms/page" << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::string config_file = "config/config.ini";
+    std::vector<std::pair<std::string, std::string>> overrides;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        if (equals == std::string::npos) {
+            config_file = arg;
+        } else {
+            overrides.emplace_back(arg.substr(0, equals), arg.substr(equals + 1));
+        }
+    }
+
+    ConfigParser config;
+    if (!config.loadConfig(config_file)) {
+        std::cerr << "Failed to load configuration file: " << config_file << std::endl;
+        return 1;
+    }
+
+    // Crawl every page in full each run, without politeness delays
+    config.setValue("crawl_delay_ms", "0");
+    config.setValue("crawl_depth", "64");
+    config.setValue("conditional_recrawl", "false");
+    config.setValue("checkpoint_interval", "0");
+
+    SiteOptions site_options;
+    int server_threads = 2;
+    try {
+        for (const auto& entry : overrides) {
+            const std::string& key = entry.first;
+            const std::string& value = entry.second;
+            if (key == "pages") {
+                site_options.pages = std::max<size_t>(1, std::stoul(value));
+            } else if (key == "hosts") {
+                site_options.hosts = std::max<size_t>(1, std::stoul(value));
+            } else if (key == "page_bytes") {
+                site_options.page_bytes = std::stoul(value);
+            } else if (key == "page_bytes_sigma") {
+                site_options.page_bytes_sigma = std::max(0.0, std::stod(value));
+            } else if (key == "fanout") {
+                site_options.fanout = std::max<size_t>(1, std::stoul(value));
+            } else if (key == "latency_ms") {
+                site_options.latency_ms = parseIntList(value);
+            } else if (key == "duplicate_ratio") {
+                site_options.duplicate_ratio = std::min(1.0, std::max(0.0, std::stod(value)));
+            } else if (key == "server_threads") {
+                server_threads = std::max(1, std::stoi(value));
+            } else if (key == "seed") {
+                site_options.seed = static_cast<unsigned>(std::stoul(value));
+            } else {
+                config.setValue(key, value);
+            }
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Invalid benchmark option" << std::endl;
+        return 1;
+    }
+    if (site_options.latency_ms.empty()) {
+        site_options.latency_ms.push_back(0);
+    }
+
+    // Start the site
+    Site site(site_options);
+    net::io_context ioc;
+    std::vector<unsigned short> ports;
+    for (size_t host = 0; host < site_options.hosts; ++host) {
+        auto listener = std::make_shared<ServerListener>(ioc, site, host);
+        ports.push_back(listener->port());
+        listener->run();
+    }
+    site.setPorts(ports);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < server_threads; ++i) {
+        threads.emplace_back([&ioc] { ioc.run(); });
+    }
+
+    config.setValue("start_url", site.url(0));
+    std::cout << "Serving " << site_options.pages << " pages on " << site_options.hosts
+              << " hosts, fan-out " << site_options.fanout << ", duplicate ratio "
+              << site_options.duplicate_ratio << std::endl;
+
+    Spider spider;
+    if (!spider.initialize(config)) {
+        std::cerr << "Failed to initialize spider" << std::endl;
+        ioc.stop();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    spider.startCrawling();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Spider::CrawlStats stats = spider.getStats();
+
+    ioc.stop();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::cout << std::endl << "Crawl benchmark results" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Elapsed:     " << elapsed << " s" << std::endl;
+    std::cout << "  Pages:       " << stats.pages_crawled << " crawled, " << stats.pages_indexed
+              << " indexed, " << stats.pages_duplicate << " near-duplicates" << std::endl;
+    std::cout << "  Throughput:  " << stats.pages_crawled / elapsed << " pages/s, "
+              << stats.bytes_received / elapsed / (1024 * 1024) << " MB/s" << std::endl;
+    std::cout << "Stage time (summed over pages):" << std::endl;
+    printStage("fetch", stats.fetch_time_us, stats.pages_crawled);
+    printStage("parse", stats.parse_time_us, stats.pages_crawled);
+    printStage("store", stats.store_time_us, stats.pages_crawled);
+    std::cout << "Queues: parse peak " << stats.parse_queue_peak << " (" << stats.fetch_throttled
+              << " fetch waits), store peak " << stats.store_queue_peak << " ("
+              << stats.parse_throttled << " parse waits)" << std::endl;
+    std::cout << "Connections: " << stats.connections_acquired << " acquired, "
+              << stats.connections_reused << " reused" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+// Compares the HTML scanning kernels on real pages: raw scanning speed and
+// full HtmlParser::parse throughput with each kernel forced.
+// Usage: html_scan_bench [--min-mb N] file...
+// Files are HTML pages or WARC captures (.warc, .warc.gz), e.g. from a
+// crawl run with capture_warc set.
+#include "../common/html_parser.h"
+#include "../common/html_scan.h"
+#include "page_corpus.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Results are added here so the work is not optimized out
+volatile size_t g_sink = 0;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Every stop of one scan class across all pages
+size_t scanAll(const std::vector<std::string>& pages, unsigned classes) {
+    size_t stops = 0;
+    for (const std::string& page : pages) {
+        size_t pos = 0;
+        while (pos < page.size()) {
+            pos += scanHtmlBytes(page.data() + pos, page.size() - pos, classes) + 1;
+            stops++;
+        }
+    }
+    return stops;
+}
+
+size_t parseAll(const std::vector<std::string>& pages, const HtmlParser& parser) {
+    size_t links = 0;
+    for (const std::string& page : pages) {
+        links += parser.parse(page, "http://example.com/").links.size();
+    }
+    return links;
+}
+
+// MB/s of repeating run() until min_bytes have been processed
+template <typename Run>
+double measure(size_t corpus_bytes, size_t min_bytes, Run run) {
+    size_t rounds = std::max<size_t>(1, min_bytes / std::max<size_t>(1, corpus_bytes));
+    size_t checksum = run();   // warm-up
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i) {
+        checksum += run();
+    }
+    double seconds = secondsSince(start);
+    g_sink += checksum;
+    return static_cast<double>(corpus_bytes) * rounds / seconds / (1024 * 1024);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    size_t min_mb = 256;
+    std::vector<std::string> pages;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--min-mb" && i + 1 < argc) {
+            min_mb = std::stoul(argv[++i]);
+        } else if (!loadPages(arg, pages)) {
+            return 1;
+        }
+    }
+    if (pages.empty()) {
+        std::cerr << "Usage: html_scan_bench [--min-mb N] page.html|capture.warc[.gz]..." << std::endl;
+        return 1;
+    }
+
+    size_t corpus_bytes = 0;
+    for (const std::string& page : pages) {
+        corpus_bytes += page.size();
+    }
+    std::cout << "Pages: " << pages.size() << ", " << corpus_bytes / 1024 << " KB" << std::endl;
+    std::cout << std::left << std::setw(10) << "kernel" << std::right
+              << std::setw(14) << "'<' MB/s"
+              << std::setw(14) << "text MB/s"
+              << std::setw(14) << "parse MB/s"
+              << std::setw(10) << "speedup" << std::endl;
+
+    HtmlParser parser;
+    size_t min_bytes = min_mb * 1024 * 1024;
+    double scalar_parse = 0;
+    for (HtmlScanKernel kernel : {HtmlScanKernel::Scalar, HtmlScanKernel::SSE2, HtmlScanKernel::AVX2}) {
+        if (!setHtmlScanKernel(kernel)) {
+            continue;
+        }
+        double markup = measure(corpus_bytes, min_bytes, [&] { return scanAll(pages, HTML_LT); });
+        double text = measure(corpus_bytes, min_bytes, [&] { return scanAll(pages, HTML_AMP | HTML_SPACE_RUN); });
+        double parse = measure(corpus_bytes, min_bytes / 8, [&] { return parseAll(pages, parser); });
+        if (kernel == HtmlScanKernel::Scalar) {
+            scalar_parse = parse;
+        }
+
+        std::cout << std::left << std::setw(10) << getHtmlScanKernelName() << std::right << std::fixed
+                  << std::setprecision(0)
+                  << std::setw(14) << markup
+                  << std::setw(14) << text
+                  << std::setw(14) << parse
+                  << std::setw(9) << std::setprecision(2) << parse / scalar_parse << "x" << std::endl;
+    }
+
+    setHtmlScanKernel(HtmlScanKernel::Auto);
+    return 0;
+}
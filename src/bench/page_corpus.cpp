@@ -0,0 +1,53 @@
+#include "page_corpus.h"
+#include "../spider/warc.h"
+#include <cctype>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+bool endsWith(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() &&
+           value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}
+
+bool loadPages(const std::string& path, std::vector<std::string>& pages) {
+    if (endsWith(path, ".warc") || endsWith(path, ".warc.gz")) {
+        WarcArchive archive(path);
+        if (!archive.open()) {
+            std::cerr << archive.getError() << std::endl;
+            return false;
+        }
+        for (const std::string& url : archive.getUrls()) {
+            std::string message;
+            if (!archive.find(url, message)) {
+                continue;
+            }
+            size_t header_end = message.find("\r\n\r\n");
+            if (header_end == std::string::npos) {
+                continue;
+            }
+            std::string header = message.substr(0, header_end);
+            for (char& c : header) {
+                c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+            if (header.find("text/html") != std::string::npos) {
+                pages.push_back(message.substr(header_end + 4));
+            }
+        }
+        return true;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "cannot open " << path << std::endl;
+        return false;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    pages.push_back(content.str());
+    return true;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Append the pages in path to pages: the bodies of a WARC capture's HTML
+// responses (.warc or .warc.gz), or else the file itself. Prints the
+// error and returns false if it cannot be read.
+bool loadPages(const std::string& path, std::vector<std::string>& pages);
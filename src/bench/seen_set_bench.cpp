@@ -0,0 +1,112 @@
+// Compares memory per URL and lookup throughput of the seen-set modes.
+// Usage: seen_set_bench [url_count]
+#include "../spider/seen_set.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> makeUrls(size_t count, size_t offset) {
+    std::vector<std::string> urls;
+    urls.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t n = i + offset;
+        urls.push_back("https://host" + std::to_string(n % 997) + ".example.com/articles/" +
+                       std::to_string(n) + "/index.html");
+    }
+    return urls;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void runMode(const std::string& label, SeenSetOptions options,
+             const std::vector<std::string>& urls, const std::vector<std::string>& unseen) {
+    options.expected_urls = urls.size();
+    std::unique_ptr<SeenSet> set = createSeenSet(options, 1);
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& url : urls) {
+        set->insert(url);
+    }
+    double insert_seconds = secondsSince(start);
+
+    // Every known URL is looked up again, as re-discovered links are
+    start = std::chrono::steady_clock::now();
+    size_t duplicates = 0;
+    for (const auto& url : urls) {
+        if (!set->insert(url)) {
+            duplicates++;
+        }
+    }
+    double hit_seconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    size_t false_positives = 0;
+    for (const auto& url : unseen) {
+        if (set->isProcessed(url)) {
+            false_positives++;
+        }
+    }
+    double miss_seconds = secondsSince(start);
+
+    for (const auto& url : unseen) {
+        if (!set->insert(url)) {
+            false_positives++;
+        }
+    }
+
+    double bytes_per_url = static_cast<double>(set->memoryUsage()) / static_cast<double>(set->size());
+    std::cout << std::left << std::setw(20) << label << std::right << std::fixed
+              << std::setw(10) << std::setprecision(1) << bytes_per_url
+              << std::setw(14) << std::setprecision(2) << urls.size() / insert_seconds / 1e6
+              << std::setw(14) << urls.size() / hit_seconds / 1e6
+              << std::setw(14) << unseen.size() / miss_seconds / 1e6
+              << std::setw(10) << duplicates
+              << std::setw(10) << false_positives << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = 1000000;
+    if (argc > 1) {
+        count = std::stoul(argv[1]);
+    }
+
+    std::vector<std::string> urls = makeUrls(count, 0);
+    std::vector<std::string> unseen = makeUrls(count / 10, count);
+
+    std::cout << "URLs: " << count << " (plus " << unseen.size() << " unseen probes)" << std::endl;
+    std::cout << std::left << std::setw(20) << "mode" << std::right
+              << std::setw(10) << "B/URL"
+              << std::setw(14) << "insert M/s"
+              << std::setw(14) << "hit M/s"
+              << std::setw(14) << "miss M/s"
+              << std::setw(10) << "dups"
+              << std::setw(10) << "false+" << std::endl;
+
+    SeenSetOptions options;
+    options.mode = "exact";
+    runMode("exact", options, urls, unseen);
+
+    options.mode = "fingerprint";
+    runMode("fingerprint", options, urls, unseen);
+
+    options.bloom_front = true;
+    runMode("fingerprint+bloom", options, urls, unseen);
+
+    options.bloom_front = false;
+    options.mode = "bloom";
+    options.false_positive_rate = 0.01;
+    runMode("bloom (1%)", options, urls, unseen);
+
+    options.false_positive_rate = 0.001;
+    runMode("bloom (0.1%)", options, urls, unseen);
+
+    return 0;
+}
@@ -0,0 +1,172 @@
+// Tokenizing and indexing throughput of TextIndexer on the visible text of
+// real pages, against the istringstream / per-token Boost.Locale path it
+// replaced, counting terms into a std::map or a TermFrequencies table, and
+// how indexDocuments scales with threads.
+// Usage: text_index_bench [--min-mb N] [--threads N] file...
+// Files are HTML pages or WARC captures (.warc, .warc.gz).
+#include "../common/html_parser.h"
+#include "../common/text_indexer.h"
+#include "page_corpus.h"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <map>
+#include <utility>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Results are added here so the work is not optimized out
+volatile size_t g_sink = 0;
+
+// TextIndexer::indexText before the ASCII fast path
+std::map<std::string, int> legacyIndexText(const std::string& text, TextIndexer& indexer, const std::locale& locale) {
+    std::string clean;
+    clean.reserve(text.size());
+    for (char c : text) {
+        bool keep = std::isalnum(static_cast<unsigned char>(c)) ||
+                    std::isspace(static_cast<unsigned char>(c)) || (c & 0x80);
+        clean += keep ? c : ' ';
+    }
+
+    std::map<std::string, int> frequencies;
+    std::istringstream words(clean);
+    std::string word;
+    while (words >> word) {
+        std::string normalized;
+        try {
+            normalized = boost::locale::fold_case(boost::locale::normalize(word, boost::locale::norm_nfd, locale), locale);
+        } catch (const std::exception&) {
+            normalized = word;
+        }
+        if (indexer.shouldIndexWord(normalized)) {
+            frequencies[normalized]++;
+        }
+    }
+    return frequencies;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Seconds per pass over texts, repeating run() until min_bytes have been processed
+template <typename Run>
+double measure(size_t corpus_bytes, size_t min_bytes, Run run) {
+    size_t rounds = std::max<size_t>(1, min_bytes / std::max<size_t>(1, corpus_bytes));
+    size_t checksum = run();   // warm-up
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i) {
+        checksum += run();
+    }
+    double seconds = secondsSince(start);
+    g_sink += checksum;
+    return seconds / rounds;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    size_t min_mb = 16;
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> pages;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--min-mb" && i + 1 < argc) {
+            min_mb = std::stoul(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            max_threads = std::max(1, std::stoi(argv[++i]));
+        } else if (!loadPages(arg, pages)) {
+            return 1;
+        }
+    }
+    if (pages.empty()) {
+        std::cerr << "Usage: text_index_bench [--min-mb N] [--threads N] page.html|capture.warc[.gz]..." << std::endl;
+        return 1;
+    }
+
+    HtmlParser parser;
+    TextIndexer indexer;
+    boost::locale::generator generator;
+    std::locale locale = generator("en_US.UTF-8");
+    std::vector<std::string> texts;
+    size_t corpus_bytes = 0;
+    size_t tokens = 0;
+    for (const std::string& page : pages) {
+        texts.push_back(parser.parse(page).text);
+        corpus_bytes += texts.back().size();
+        tokens += indexer.tokenize(texts.back()).size();
+    }
+    std::cout << "Pages: " << texts.size() << ", text " << corpus_bytes / 1024 << " KB, "
+              << tokens << " tokens" << std::endl;
+
+    size_t min_bytes = min_mb * 1024 * 1024;
+    double legacy = measure(corpus_bytes, min_bytes / 8, [&] {
+        size_t terms = 0;
+        for (const std::string& text : texts) {
+            terms += legacyIndexText(text, indexer, locale).size();
+        }
+        return terms;
+    });
+    double map = measure(corpus_bytes, min_bytes, [&] {
+        size_t terms = 0;
+        for (const std::string& text : texts) {
+            terms += indexer.indexText(text).size();
+        }
+        return terms;
+    });
+    TermFrequencies table;
+    double table_reused = measure(corpus_bytes, min_bytes, [&] {
+        size_t terms = 0;
+        for (const std::string& text : texts) {
+            indexer.indexText(text, table);
+            terms += table.size();
+        }
+        return terms;
+    });
+    double table_per_page = measure(corpus_bytes, min_bytes, [&] {
+        size_t terms = 0;
+        for (const std::string& text : texts) {
+            TermFrequencies page_terms;   // the spider hands each page's table to a store thread
+            indexer.indexText(text, page_terms);
+            terms += page_terms.size();
+        }
+        return terms;
+    });
+
+    std::cout << std::left << std::setw(16) << "path" << std::right
+              << std::setw(16) << "M tokens/s"
+              << std::setw(12) << "MB/s"
+              << std::setw(10) << "speedup" << std::endl;
+    std::vector<std::pair<std::string, double>> rows = {
+        {"legacy", legacy}, {"std::map", map}, {"table, reused", table_reused}, {"table, per page", table_per_page}
+    };
+
+    // The whole corpus as one batch, split over 1, 2, 4, ... threads
+    std::vector<std::string_view> documents(texts.begin(), texts.end());
+    std::vector<TermFrequencies> results;
+    for (unsigned threads = 1; ; threads = std::min(threads * 2, max_threads)) {
+        double batch = measure(corpus_bytes, min_bytes, [&] {
+            indexer.indexDocuments(documents, results, threads);
+            return results.size();
+        });
+        rows.emplace_back("batch, " + std::to_string(threads) + " thr", batch);
+        if (threads == max_threads) {
+            break;
+        }
+    }
+
+    for (const auto& row : rows) {
+        std::cout << std::left << std::setw(16) << row.first << std::right << std::fixed
+                  << std::setw(16) << std::setprecision(2) << tokens / row.second / 1e6
+                  << std::setw(12) << std::setprecision(1) << corpus_bytes / row.second / (1024 * 1024)
+                  << std::setw(9) << std::setprecision(1) << legacy / row.second << "x" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+// Link classification rate of UrlFilter against the substring checks it
+// replaced, with the default rules and with a larger configured rule set.
+// Usage: url_filter_bench [link_count]
+#include "../spider/url_filter.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Results are added here so the work is not optimized out
+volatile size_t g_sink = 0;
+
+// Links shaped like those found on real pages: mostly articles, some
+// assets, listing pages with queries and links to other sites
+std::vector<std::string> makeLinks(size_t count) {
+    static const char* const HOSTS[] = {
+        "www.example.com", "docs.example.com", "cdn.example.net", "blog.example.org",
+        "ads.tracker.example", "static.example.com", "news.example.co.uk", "example.io"
+    };
+    static const char* const TAILS[] = {
+        "/articles/%/index.html", "/wiki/Topic_%", "/img/photo-%.JPG", "/assets/app.%.js",
+        "/search?q=term%&page=2", "/docs.json/page/%", "/api/jsonify/%", "/feed/%/rss",
+        "/wp-admin/post.php?post=%", "/downloads/report-%.pdf", "/tag/%/", "/print/%"
+    };
+
+    std::vector<std::string> links;
+    links.reserve(count);
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for (size_t i = 0; i < count; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        std::string tail = TAILS[state % (sizeof(TAILS) / sizeof(TAILS[0]))];
+        tail.replace(tail.find('%'), 1, std::to_string(state % 100000));
+        links.push_back(std::string(i % 50 == 0 ? "http://" : "https://") +
+                        HOSTS[(state >> 20) % (sizeof(HOSTS) / sizeof(HOSTS[0]))] + tail);
+    }
+    return links;
+}
+
+// The filter Spider::shouldCrawlUrl used before UrlFilter
+bool legacyShouldCrawl(const std::string& url) {
+    if (url.find("http://") != 0 && url.find("https://") != 0) {
+        return false;
+    }
+    std::vector<std::string> skip_extensions = {
+        ".css", ".js", ".jpg", ".jpeg", ".png", ".gif", ".pdf",
+        ".zip", ".rar", ".exe", ".dmg", ".mp3", ".mp4", ".avi"
+    };
+    for (const std::string& ext : skip_extensions) {
+        if (url.find(ext) != std::string::npos) {
+            return false;
+        }
+    }
+    return url.length() <= 500;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Filter>
+void run(const std::string& label, const std::vector<std::string>& links, Filter filter) {
+    size_t allowed = 0;
+    for (const auto& link : links) {   // warm-up
+        allowed += filter(link) ? 1 : 0;
+    }
+
+    const int rounds = 5;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (const auto& link : links) {
+            allowed += filter(link) ? 1 : 0;
+        }
+    }
+    double seconds = secondsSince(start);
+    g_sink += allowed;
+
+    std::cout << std::left << std::setw(24) << label << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << links.size() * rounds / seconds / 1e6 << " M links/s"
+              << std::setw(10) << std::setprecision(1) << 100.0 * allowed / (links.size() * (rounds + 1))
+              << "% allowed" << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    std::vector<std::string> links = makeLinks(count);
+    std::cout << "Links: " << links.size() << std::endl;
+
+    run("legacy substring", links, legacyShouldCrawl);
+
+    UrlFilter::Rules rules;
+    rules.skip_extensions = UrlFilter::Rules::defaultSkipExtensions();
+    UrlFilter default_filter(rules);
+    run("compiled, default", links, [&](const std::string& url) { return default_filter.isAllowed(url); });
+
+    rules.deny_domains = {"tracker.example", "cdn.example.net"};
+    rules.skip_extensions.insert(rules.skip_extensions.end(), {"svg", "ico", "woff", "woff2", "webp", "xml"});
+    rules.deny_path_prefixes = {"/wp-admin/", "/search?", "/print/", "/cart", "/login"};
+    rules.deny_path_suffixes = {"/rss", "/amp", "/feed"};
+    UrlFilter configured_filter(rules);
+    std::cout << "Configured rules: " << configured_filter.getRuleCount() << std::endl;
+    run("compiled, configured", links, [&](const std::string& url) { return configured_filter.isAllowed(url); });
+
+    rules.deny_regex = "[?&](sessionid|utm_[a-z]+)=";
+    UrlFilter regex_filter(rules);
+    run("compiled, with regex", links, [&](const std::string& url) { return regex_filter.isAllowed(url); });
+
+    return 0;
+}
@@ -82,6 +82,18 @@ std::string ConfigParser::getValue(const std::string& key) const {
     return "";
 }
 
+int ConfigParser::getIntValue(const std::string& key, int default_value) const {
+    try {
+        return std::stoi(getValue(key));
+    } catch (const std::exception&) {
+        return default_value;
+    }
+}
+
+void ConfigParser::setValue(const std::string& key, const std::string& value) {
+    config_[key] = value;
+}
+
 void ConfigParser::trim(std::string& str) {
     // Remove leading whitespace
     str.erase(str.begin(), std::find_if(str.begin(), str.end(), [](unsigned char ch) {
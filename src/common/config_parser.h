@@ -27,8 +27,12 @@ public:
     // Search server configuration
     int getServerPort() const;
     
-    // Generic getter
+    // Generic getters
     std::string getValue(const std::string& key) const;
+    int getIntValue(const std::string& key, int default_value) const;
+    
+    // Set or override a value (e.g. from the command line)
+    void setValue(const std::string& key, const std::string& value);
     
 private:
     std::map<std::string, std::string> config_;
@@ -1,6 +1,7 @@
 #include "database.h"
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 
 Database::Database() : connected_(false) {
 }
@@ -10,6 +11,8 @@ Database::~Database() {
 }
 
 bool Database::connect(const ConfigParser& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
     try {
         std::string connectionString = createConnectionString(config);
         conn_ = std::make_unique<pqxx::connection>(connectionString);
@@ -28,6 +31,8 @@ bool Database::connect(const ConfigParser& config) {
 }
 
 void Database::disconnect() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
     if (conn_ && conn_->is_open()) {
         conn_->close();
     }
@@ -35,6 +40,8 @@ void Database::disconnect() {
 }
 
 bool Database::createTables() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
     if (!connected_) {
         return false;
     }
@@ -53,6 +60,27 @@ bool Database::createTables() {
             )
         )");
         
+        // Re-crawl validators and outgoing links (added to existing databases too)
+        txn.exec(R"(
+            ALTER TABLE documents
+                ADD COLUMN IF NOT EXISTS etag TEXT,
+                ADD COLUMN IF NOT EXISTS last_modified TEXT,
+                ADD COLUMN IF NOT EXISTS content_hash VARCHAR(32),
+                ADD COLUMN IF NOT EXISTS links TEXT,
+                ADD COLUMN IF NOT EXISTS fetched_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+                ADD COLUMN IF NOT EXISTS simhash BIGINT
+        )");
+        
+        // Pages skipped as near-duplicates of an indexed page
+        txn.exec(R"(
+            CREATE TABLE IF NOT EXISTS duplicates (
+                url VARCHAR(2048) PRIMARY KEY,
+                canonical_url VARCHAR(2048) NOT NULL,
+                distance INTEGER NOT NULL,
+                found_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+            )
+        )");
+        
         // Create words table
         txn.exec(R"(
             CREATE TABLE IF NOT EXISTS words (
@@ -87,6 +115,8 @@ bool Database::createTables() {
 }
 
 int Database::insertDocument(const std::string& url, const std::string& title, const std::string& content) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
     if (!connected_) {
         return -1;
     }
@@ -125,6 +155,8 @@ int Database::insertDocument(const std::string& url, const std::string& title, c
 }
 
 bool Database::documentExists(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
     if (!connected_) {
         return false;
     }
@@ -142,7 +174,242 @@ bool Database::documentExists(const std::string& url) {
     }
 }
 
+int Database::storeDocument(const std::string& url, const std::string& title, const std::string& content,
+                            const DocumentValidators& validators, const std::vector<std::string>& links,
+                            int64_t simhash, const TermFrequencies& words) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (!connected_) {
+        return -1;
+    }
+    
+    std::string joined_links;
+    for (const std::string& link : links) {
+        joined_links += link;
+        joined_links += '\n';
+    }
+    
+    try {
+        pqxx::work txn(*conn_);
+        
+        pqxx::result r = txn.exec_params(R"(
+            INSERT INTO documents (url, title, content, etag, last_modified, content_hash, links, simhash, fetched_at)
+            VALUES ($1, $2, $3, $4, $5, $6, $7, $8, CURRENT_TIMESTAMP)
+            ON CONFLICT (url) DO UPDATE SET
+                title = EXCLUDED.title,
+                content = EXCLUDED.content,
+                etag = EXCLUDED.etag,
+                last_modified = EXCLUDED.last_modified,
+                content_hash = EXCLUDED.content_hash,
+                links = EXCLUDED.links,
+                simhash = EXCLUDED.simhash,
+                fetched_at = CURRENT_TIMESTAMP
+            RETURNING id
+        )", url, title, content, validators.etag, validators.last_modified,
+            validators.content_hash, joined_links, simhash);
+        
+        // A page indexed on its own is no longer a duplicate
+        txn.exec_params("DELETE FROM duplicates WHERE url = $1", url);
+        
+        if (r.empty()) {
+            return -1;
+        }
+        
+        int document_id = r[0][0].as<int>();
+        
+        // The page is re-indexed from scratch
+        txn.exec_params("DELETE FROM word_frequencies WHERE document_id = $1", document_id);
+        
+        // New words are inserted in term order, so store threads adding the
+        // same words concurrently lock them in the same order
+        std::vector<const TermFrequencies::Term*> terms;
+        terms.reserve(words.size());
+        for (const TermFrequencies::Term& term : words.getTerms()) {
+            terms.push_back(&term);
+        }
+        std::sort(terms.begin(), terms.end(),
+                  [](const TermFrequencies::Term* a, const TermFrequencies::Term* b) { return a->term < b->term; });
+        
+        std::string word;
+        for (const TermFrequencies::Term* term : terms) {
+            word.assign(term->term);
+            pqxx::result word_result = txn.exec_params(
+                "INSERT INTO words (word) VALUES ($1) ON CONFLICT (word) DO NOTHING RETURNING id",
+                word
+            );
+            if (word_result.empty()) {
+                word_result = txn.exec_params("SELECT id FROM words WHERE word = $1", word);
+            }
+            if (word_result.empty()) {
+                // Leaves the transaction uncommitted: nothing of the page is stored
+                std::cerr << "Error storing document: no id for word " << word << std::endl;
+                return -1;
+            }
+            txn.exec_params(R"(
+                INSERT INTO word_frequencies (document_id, word_id, frequency)
+                VALUES ($1, $2, $3)
+                ON CONFLICT (document_id, word_id)
+                DO UPDATE SET frequency = word_frequencies.frequency + $3
+            )", document_id, word_result[0][0].as<int>(), term->frequency);
+        }
+        
+        txn.commit();
+        return document_id;
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Error storing document: " << e.what() << std::endl;
+    }
+    
+    return -1;
+}
+
+bool Database::getDocumentValidators(const std::string& url, DocumentValidators& validators) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (!connected_) {
+        return false;
+    }
+    
+    try {
+        pqxx::nontransaction ntxn(*conn_);
+        pqxx::result r = ntxn.exec_params(
+            "SELECT id, etag, last_modified, content_hash FROM documents WHERE url = $1",
+            url
+        );
+        
+        if (r.empty()) {
+            return false;
+        }
+        
+        validators.document_id = r[0][0].as<int>();
+        validators.etag = r[0][1].is_null() ? "" : r[0][1].as<std::string>();
+        validators.last_modified = r[0][2].is_null() ? "" : r[0][2].as<std::string>();
+        validators.content_hash = r[0][3].is_null() ? "" : r[0][3].as<std::string>();
+        return true;
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Error getting document validators: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool Database::touchDocument(int document_id, const DocumentValidators& validators) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (!connected_) {
+        return false;
+    }
+    
+    try {
+        pqxx::work txn(*conn_);
+        
+        // Keep the stored validators unless the server sent new ones
+        txn.exec_params(R"(
+            UPDATE documents SET
+                etag = COALESCE(NULLIF($2, ''), etag),
+                last_modified = COALESCE(NULLIF($3, ''), last_modified),
+                fetched_at = CURRENT_TIMESTAMP
+            WHERE id = $1
+        )", document_id, validators.etag, validators.last_modified);
+        
+        txn.commit();
+        return true;
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Error updating document: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+std::vector<std::string> Database::getDocumentLinks(int document_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    std::vector<std::string> links;
+    
+    if (!connected_) {
+        return links;
+    }
+    
+    try {
+        pqxx::nontransaction ntxn(*conn_);
+        pqxx::result r = ntxn.exec_params("SELECT links FROM documents WHERE id = $1", document_id);
+        
+        if (r.empty() || r[0][0].is_null()) {
+            return links;
+        }
+        
+        std::string joined_links = r[0][0].as<std::string>();
+        size_t start = 0;
+        size_t end;
+        while ((end = joined_links.find('\n', start)) != std::string::npos) {
+            if (end > start) {
+                links.push_back(joined_links.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Error getting document links: " << e.what() << std::endl;
+    }
+    
+    return links;
+}
+
+bool Database::storeDuplicate(const std::string& url, const std::string& canonical_url, int distance) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (!connected_) {
+        return false;
+    }
+    
+    try {
+        pqxx::work txn(*conn_);
+        
+        txn.exec_params(R"(
+            INSERT INTO duplicates (url, canonical_url, distance, found_at)
+            VALUES ($1, $2, $3, CURRENT_TIMESTAMP)
+            ON CONFLICT (url) DO UPDATE SET
+                canonical_url = EXCLUDED.canonical_url,
+                distance = EXCLUDED.distance,
+                found_at = CURRENT_TIMESTAMP
+        )", url, canonical_url, distance);
+        
+        txn.commit();
+        return true;
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Error storing duplicate: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+std::vector<std::pair<std::string, int64_t>> Database::getDocumentFingerprints() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    std::vector<std::pair<std::string, int64_t>> fingerprints;
+    
+    if (!connected_) {
+        return fingerprints;
+    }
+    
+    try {
+        pqxx::nontransaction ntxn(*conn_);
+        pqxx::result r = ntxn.exec("SELECT url, simhash FROM documents WHERE simhash IS NOT NULL AND simhash <> 0");
+        
+        fingerprints.reserve(r.size());
+        for (const auto& row : r) {
+            fingerprints.emplace_back(row[0].as<std::string>(), row[1].as<int64_t>());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error getting document fingerprints: " << e.what() << std::endl;
+    }
+    
+    return fingerprints;
+}
+
 std::vector<Document> Database::getAllDocuments() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
     std::vector<Document> documents;
     
     if (!connected_) {
@@ -170,6 +437,8 @@ std::vector<Document> Database::getAllDocuments() {
 }
 
 int Database::getOrCreateWord(const std::string& word) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
     if (!connected_) {
         return -1;
     }
@@ -187,12 +456,19 @@ int Database::getOrCreateWord(const std::string& word) {
             return r[0][0].as<int>();
         }
         
-        // Insert new word
+        // Insert new word; another connection may insert it first
         pqxx::result insert_result = txn.exec_params(
-            "INSERT INTO words (word) VALUES ($1) RETURNING id",
+            "INSERT INTO words (word) VALUES ($1) ON CONFLICT (word) DO NOTHING RETURNING id",
             word
         );
         
+        if (insert_result.empty()) {
+            insert_result = txn.exec_params(
+                "SELECT id FROM words WHERE word = $1",
+                word
+            );
+        }
+        
         txn.commit();
         
         if (!insert_result.empty()) {
@@ -207,6 +483,8 @@ int Database::getOrCreateWord(const std::string& word) {
 }
 
 bool Database::insertWordFrequency(int document_id, int word_id, int frequency) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
     if (!connected_) {
         return false;
     }
@@ -232,6 +510,8 @@ bool Database::insertWordFrequency(int document_id, int word_id, int frequency)
 }
 
 std::vector<SearchResult> Database::searchDocuments(const std::vector<std::string>& words, int limit) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
     std::vector<SearchResult> results;
     
     if (!connected_ || words.empty()) {
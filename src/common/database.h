@@ -3,8 +3,11 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <cstdint>
 #include <pqxx/pqxx>
 #include "config_parser.h"
+#include "term_frequencies.h"
 
 struct Document {
     int id;
@@ -14,6 +17,14 @@ struct Document {
     std::string created_at;
 };
 
+// Validators stored with a document, used to skip unchanged pages on re-crawl
+struct DocumentValidators {
+    int document_id = -1;   // -1 if the URL is not stored
+    std::string etag;
+    std::string last_modified;
+    std::string content_hash;
+};
+
 struct Word {
     int id;
     std::string word;
@@ -46,6 +57,29 @@ public:
     // Document operations
     int insertDocument(const std::string& url, const std::string& title, const std::string& content);
     bool documentExists(const std::string& url);
+    
+    // Insert or replace a document with its validators, outgoing links,
+    // SimHash fingerprint and word frequencies in one transaction, so a
+    // document never has new validators over a partial index. Returns the
+    // document id, or -1 if nothing was stored.
+    int storeDocument(const std::string& url, const std::string& title, const std::string& content,
+                      const DocumentValidators& validators, const std::vector<std::string>& links,
+                      int64_t simhash, const TermFrequencies& words);
+    
+    // Record url as a near-duplicate of canonical_url instead of indexing it
+    bool storeDuplicate(const std::string& url, const std::string& canonical_url, int distance);
+    
+    // URL and SimHash fingerprint of every document that has one
+    std::vector<std::pair<std::string, int64_t>> getDocumentFingerprints();
+    
+    // Look up the validators of a stored document; false if the URL is unknown
+    bool getDocumentValidators(const std::string& url, DocumentValidators& validators);
+    
+    // Record a re-fetch that found the document unchanged
+    bool touchDocument(int document_id, const DocumentValidators& validators);
+    
+    // Outgoing links saved with a document
+    std::vector<std::string> getDocumentLinks(int document_id);
     std::vector<Document> getAllDocuments();
     
     // Word operations
@@ -62,5 +96,10 @@ private:
     std::unique_ptr<pqxx::connection> conn_;
     bool connected_;
     
+    // Serializes the threads using this object's one connection. Threads
+    // that must not wait on each other, such as the spider's lookup and
+    // store threads, each open a Database of their own.
+    std::mutex mutex_;
+    
     std::string createConnectionString(const ConfigParser& config);
 };
\ No newline at end of file
@@ -1,124 +1,503 @@
 #include "html_parser.h"
+#include "html_scan.h"
+#include "url.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <cctype>
+#include <cstring>
+#include <cstdint>
 #include <boost/locale/encoding.hpp>
 
-// HtmlParser implementation
-HtmlParser::HtmlParser() {
+namespace {
+
+struct NamedEntity {
+    const char* name;
+    uint32_t codepoint;
+};
+
+// The entities seen in practice; anything else is left as written
+const NamedEntity NAMED_ENTITIES[] = {
+    {"amp", '&'}, {"lt", '<'}, {"gt", '>'}, {"quot", '"'}, {"apos", '\''},
+    {"nbsp", 0xA0}, {"copy", 0xA9}, {"reg", 0xAE}, {"trade", 0x2122},
+    {"laquo", 0xAB}, {"raquo", 0xBB}, {"middot", 0xB7}, {"deg", 0xB0},
+    {"ndash", 0x2013}, {"mdash", 0x2014}, {"hellip", 0x2026}, {"bull", 0x2022},
+    {"lsquo", 0x2018}, {"rsquo", 0x2019}, {"ldquo", 0x201C}, {"rdquo", 0x201D},
+    {"euro", 0x20AC}, {"pound", 0xA3}, {"yen", 0xA5}, {"cent", 0xA2},
+    {"sect", 0xA7}, {"para", 0xB6}, {"times", 0xD7}, {"divide", 0xF7},
+};
+
+const size_t MAX_ENTITY_NAME = 8;
+
+inline bool isAlpha(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
 }
 
-HtmlParser::~HtmlParser() {
+inline char toLower(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : static_cast<char>(c);
 }
 
-std::string HtmlParser::extractText(const std::string& html) {
-    // First, try to detect encoding
-    std::string encoding = "UTF-8"; // Default assumption
+// Case-insensitive match of a lower-case literal at pos
+bool matchesAt(const std::string& s, size_t pos, const char* literal) {
+    size_t length = std::strlen(literal);
+    if (pos + length > s.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        if (toLower(static_cast<unsigned char>(s[pos + i])) != literal[i]) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    // Check for meta charset tag
-    std::regex charset_regex(R"(<meta[^>]*charset\s*=\s*["']?([^"'>\s]+)[^>]*>)", std::regex_constants::icase);
-    std::smatch match;
-    if (std::regex_search(html, match, charset_regex)) {
-        encoding = match[1].str();
-        // Convert to uppercase for consistency
-        std::transform(encoding.begin(), encoding.end(), encoding.begin(), ::toupper);
+void appendUtf8(std::string& out, uint32_t codepoint) {
+    if (codepoint < 0x80) {
+        out += static_cast<char>(codepoint);
+    } else if (codepoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codepoint >> 6));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else if (codepoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codepoint >> 12));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (codepoint >> 18));
+        out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
     }
+}
 
-    std::string text = removeHtmlTags(html);
+// Decode the character reference starting at pos (which holds '&') and
+// ending before end. On success pos is moved past it.
+bool decodeEntity(const std::string& s, size_t& pos, size_t end, uint32_t& codepoint) {
+    size_t i = pos + 1;
 
-    // If not UTF-8, convert to UTF-8 (simplified approach)
-    if (encoding != "UTF-8" && encoding != "UTF8") {
-        try {
-            text = boost::locale::conv::to_utf<char>(text, encoding);
+    if (i < end && s[i] == '#') {
+        ++i;
+        bool hex = i < end && (s[i] == 'x' || s[i] == 'X');
+        if (hex) {
+            ++i;
         }
-        catch (...) {
-            // Conversion failed, keep original text
+        size_t digits_start = i;
+        uint32_t value = 0;
+        while (i < end && i - digits_start < 8) {
+            unsigned char c = static_cast<unsigned char>(s[i]);
+            int digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (hex && c >= 'a' && c <= 'f') {
+                digit = c - 'a' + 10;
+            } else if (hex && c >= 'A' && c <= 'F') {
+                digit = c - 'A' + 10;
+            } else {
+                break;
+            }
+            value = value * (hex ? 16 : 10) + static_cast<uint32_t>(digit);
+            ++i;
+        }
+        if (i == digits_start) {
+            return false;
+        }
+        if (i < end && s[i] == ';') {
+            ++i;
+        }
+        bool valid = value != 0 && value <= 0x10FFFF && (value < 0xD800 || value > 0xDFFF);
+        codepoint = valid ? value : 0xFFFD;
+        pos = i;
+        return true;
+    }
+
+    size_t name_start = i;
+    while (i < end && i - name_start <= MAX_ENTITY_NAME && std::isalnum(static_cast<unsigned char>(s[i]))) {
+        ++i;
+    }
+    if (i == name_start || i >= end || s[i] != ';') {
+        return false;
+    }
+    size_t name_length = i - name_start;
+    for (const NamedEntity& entity : NAMED_ENTITIES) {
+        if (std::strlen(entity.name) == name_length && s.compare(name_start, name_length, entity.name) == 0) {
+            codepoint = entity.codepoint;
+            pos = i + 1;
+            return true;
         }
     }
+    return false;
+}
+
+// Append s[begin, end) to out with entities decoded; with collapse set,
+// runs of whitespace become one space and none is left at either end
+// (pending_space carries a run over to the next call)
+void appendText(const std::string& s, size_t begin, size_t end, std::string& out,
+                bool collapse, bool& pending_space) {
+    const char* data = s.data();
+    unsigned breaks = collapse ? (HTML_AMP | HTML_SPACE_RUN) : HTML_AMP;
+    size_t i = begin;
+    while (i < end) {
+        unsigned char c = static_cast<unsigned char>(data[i]);
+
+        if (collapse && isHtmlSpace(c)) {
+            pending_space = true;
+            i += skipHtmlSpace(data + i, end - i);
+            continue;
+        }
+
+        uint32_t codepoint = 0;
+        bool entity = (c == '&') && decodeEntity(s, i, end, codepoint);
+        if (entity && collapse && (codepoint == 0xA0 || (codepoint < 0x80 && isHtmlSpace(static_cast<unsigned char>(codepoint))))) {
+            pending_space = true;
+            continue;
+        }
 
-    // Remove extra whitespace
-    std::regex whitespace_regex(R"(\s+)");
-    text = std::regex_replace(text, whitespace_regex, " ");
+        if (pending_space && !out.empty()) {
+            out += ' ';
+        }
+        pending_space = false;
 
-    // Trim leading and trailing whitespace
-    text.erase(text.begin(), std::find_if(text.begin(), text.end(), [](unsigned char ch) {
-        return !std::isspace(ch);
-        }));
-    text.erase(std::find_if(text.rbegin(), text.rend(), [](unsigned char ch) {
-        return !std::isspace(ch);
-        }).base(), text.end());
+        if (entity) {
+            appendUtf8(out, codepoint);
+            continue;
+        }
 
-    return text;
+        // Copy up to the next entity or whitespace that needs collapsing in
+        // one go; single spaces between words are copied as they are
+        size_t run_end = i + 1 + scanHtmlBytes(data + i + 1, end - i - 1, breaks);
+        out.append(data + i, run_end - i);
+        i = run_end;
+        if (collapse && out.back() == ' ') {
+            out.pop_back();
+            pending_space = true;
+        }
+    }
 }
 
-std::string HtmlParser::extractTitle(const std::string& html) {
-    std::regex title_regex(R"(<title[^>]*>(.*?)</title>)", std::regex_constants::icase);
-    std::smatch match;
-    
-    if (std::regex_search(html, match, title_regex)) {
-        std::string title = match[1].str();
-        return extractText(title); // Remove any remaining HTML tags from title
-    }
-    
-    return "";
+// Position of the first '<' at or after pos, or the end of the document
+size_t findMarkup(const std::string& html, size_t pos) {
+    return pos + scanHtmlBytes(html.data() + pos, html.size() - pos, HTML_LT);
 }
 
-std::vector<std::string> HtmlParser::extractLinks(const std::string& html, const std::string& baseUrl) {
-    std::vector<std::string> links;
-    std::regex link_regex(R"(<a[^>]*href\s*=\s*["\']([^"\']*)["\'][^>]*>)", std::regex_constants::icase);
-    
-    std::sregex_iterator iter(html.begin(), html.end(), link_regex);
-    std::sregex_iterator end;
-    
-    for (; iter != end; ++iter) {
-        std::string link = (*iter)[1].str();
-        
-        // Skip empty links, javascript, mailto, etc.
-        if (link.empty() || link.find("javascript:") == 0 || 
-            link.find("mailto:") == 0 || link.find("#") == 0) {
-            continue;
+// Position of the closing tag "</name" at or after pos, or the end of the document
+size_t findClosingTag(const std::string& html, size_t pos, const char* closing) {
+    while ((pos = findMarkup(html, pos)) < html.size()) {
+        if (matchesAt(html, pos, closing)) {
+            return pos;
         }
-        
-        // Resolve relative URLs
-        if (!baseUrl.empty()) {
-            link = resolveUrl(baseUrl, link);
+        ++pos;
+    }
+    return html.size();
+}
+
+enum class Tag { Other, A, Meta, Title, Script, Style, Textarea };
+
+Tag classifyTag(const char* name) {
+    if (std::strcmp(name, "a") == 0) return Tag::A;
+    if (std::strcmp(name, "meta") == 0) return Tag::Meta;
+    if (std::strcmp(name, "title") == 0) return Tag::Title;
+    if (std::strcmp(name, "script") == 0) return Tag::Script;
+    if (std::strcmp(name, "style") == 0) return Tag::Style;
+    if (std::strcmp(name, "textarea") == 0) return Tag::Textarea;
+    return Tag::Other;
+}
+
+std::string upperCase(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    return value;
+}
+
+// Charset from a Content-Type value such as "text/html; charset=utf-8"
+std::string charsetFromContentType(const std::string& content) {
+    for (size_t pos = 0; pos + 8 <= content.size(); ++pos) {
+        if (matchesAt(content, pos, "charset=")) {
+            size_t start = pos + 8;
+            size_t end = start;
+            while (end < content.size() && content[end] != ';' && content[end] != '"' &&
+                   content[end] != '\'' && !isHtmlSpace(static_cast<unsigned char>(content[end]))) {
+                ++end;
+            }
+            return content.substr(start, end - start);
         }
-        
-        links.push_back(link);
     }
-    
-    return links;
+    return "";
 }
 
-std::string HtmlParser::removeHtmlTags(const std::string& html) {
-    std::regex tag_regex("<[^>]*>");
-    return std::regex_replace(html, tag_regex, " ");
+bool isUtf8Compatible(const std::string& charset) {
+    return charset == "UTF-8" || charset == "UTF8" || charset == "US-ASCII" || charset == "ASCII";
 }
 
-std::string HtmlParser::resolveUrl(const std::string& baseUrl, const std::string& relativeUrl) {
-    // Simple URL resolution - in a real implementation, you'd want more robust URL parsing
-    if (relativeUrl.find("http://") == 0 || relativeUrl.find("https://") == 0) {
-        return relativeUrl; // Already absolute
+// Tokenizes a document in one forward pass, writing into result
+class HtmlScanner {
+public:
+    // With stop_on_charset set, the scan ends as soon as a charset other
+    // than UTF-8 is declared, so the page can be converted and scanned again
+    HtmlScanner(const std::string& html, ParsedHtml& result, bool stop_on_charset)
+        : html_(html)
+        , result_(result)
+        , stop_on_charset_(stop_on_charset)
+        , pos_(0)
+        , pending_space_(false)
+        , have_title_(false) {
+    }
+
+    // False if stopped because of the declared charset
+    bool run() {
+        size_t size = html_.size();
+        while (pos_ < size) {
+            size_t markup = findMarkup(html_, pos_);
+            appendText(html_, pos_, markup, result_.text, true, pending_space_);
+            pos_ = markup;
+            if (pos_ >= size) {
+                break;
+            }
+
+            unsigned char next = pos_ + 1 < size ? static_cast<unsigned char>(html_[pos_ + 1]) : 0;
+            if (next == '!') {
+                skipDeclaration();
+            } else if (next == '?') {
+                skipPastTagEnd();
+            } else if (next == '/') {
+                // End tag; a stray "</" followed by junk is dropped too
+                skipPastTagEnd();
+                pending_space_ = true;
+            } else if (isAlpha(next)) {
+                if (!readTag()) {
+                    return false;
+                }
+            } else {
+                // A lone '<' is text
+                appendText(html_, pos_, pos_ + 1, result_.text, true, pending_space_);
+                pos_++;
+            }
+        }
+        return true;
+    }
+
+private:
+    const std::string& html_;
+    ParsedHtml& result_;
+    bool stop_on_charset_;
+    size_t pos_;
+    bool pending_space_;
+    bool have_title_;
+
+    void skipPastTagEnd() {
+        pos_ += scanHtmlBytes(html_.data() + pos_, html_.size() - pos_, HTML_GT);
+        if (pos_ < html_.size()) {
+            pos_++;
+        }
+    }
+
+    void skipDeclaration() {
+        if (html_.compare(pos_, 4, "<!--") == 0) {
+            size_t end = html_.find("-->", pos_ + 4);
+            pos_ = end == std::string::npos ? html_.size() : end + 3;
+        } else {
+            skipPastTagEnd();
+        }
+        pending_space_ = true;
+    }
+
+    void skipSpaces() {
+        pos_ += skipHtmlSpace(html_.data() + pos_, html_.size() - pos_);
+    }
+
+    // Lower-cased name of up to size - 1 characters; longer names are
+    // truncated, which only matters for names we never look at
+    void readName(char* name, size_t size, const char* terminators) {
+        size_t length = 0;
+        while (pos_ < html_.size()) {
+            unsigned char c = static_cast<unsigned char>(html_[pos_]);
+            if (isHtmlSpace(c) || std::strchr(terminators, c)) {
+                break;
+            }
+            if (length + 1 < size) {
+                name[length++] = toLower(c);
+            }
+            pos_++;
+        }
+        name[length] = '\0';
     }
-    
-    if (relativeUrl[0] == '/') {
-        // Absolute path - extract domain from base URL
-        size_t protocolEnd = baseUrl.find("://");
-        if (protocolEnd != std::string::npos) {
-            size_t domainEnd = baseUrl.find('/', protocolEnd + 3);
-            if (domainEnd != std::string::npos) {
-                return baseUrl.substr(0, domainEnd) + relativeUrl;
+
+    // Start tag at pos_; false if scanning should stop for the charset
+    bool readTag() {
+        pos_++;
+        char name[16];
+        readName(name, sizeof(name), "/>");
+        Tag tag = classifyTag(name);
+
+        std::string href;
+        std::string charset;
+        std::string content;
+        bool have_href = false;
+
+        // Attributes: name, name=value, name="value" or name='value'
+        while (pos_ < html_.size()) {
+            skipSpaces();
+            if (pos_ >= html_.size()) {
+                break;
+            }
+            char c = html_[pos_];
+            if (c == '>') {
+                pos_++;
+                break;
+            }
+            if (c == '/') {
+                pos_++;
+                continue;
+            }
+
+            char attribute[16];
+            readName(attribute, sizeof(attribute), "/>=");
+            if (attribute[0] == '\0') {
+                // Stray '=' or similar
+                pos_++;
+                continue;
+            }
+            skipSpaces();
+            if (pos_ >= html_.size() || html_[pos_] != '=') {
+                continue;
+            }
+            pos_++;
+            skipSpaces();
+
+            size_t value_start;
+            size_t value_end;
+            if (pos_ < html_.size() && (html_[pos_] == '"' || html_[pos_] == '\'')) {
+                char quote = html_[pos_];
+                value_start = pos_ + 1;
+                size_t found = html_.find(quote, value_start);
+                value_end = found == std::string::npos ? html_.size() : found;
+                pos_ = found == std::string::npos ? html_.size() : found + 1;
             } else {
-                return baseUrl + relativeUrl;
+                value_start = pos_;
+                pos_ += scanHtmlBytes(html_.data() + pos_, html_.size() - pos_, HTML_SPACE | HTML_GT);
+                value_end = pos_;
+            }
+
+            bool unused = false;
+            if (tag == Tag::A && !have_href && std::strcmp(attribute, "href") == 0) {
+                appendText(html_, value_start, value_end, href, false, unused);
+                have_href = true;
+            } else if (tag == Tag::Meta && std::strcmp(attribute, "charset") == 0) {
+                appendText(html_, value_start, value_end, charset, false, unused);
+            } else if (tag == Tag::Meta && std::strcmp(attribute, "content") == 0) {
+                appendText(html_, value_start, value_end, content, false, unused);
+            }
+        }
+        pending_space_ = true;
+
+        switch (tag) {
+        case Tag::A:
+            if (have_href) {
+                result_.links.push_back(std::move(href));
+            }
+            break;
+        case Tag::Meta:
+            if (result_.charset.empty()) {
+                if (charset.empty()) {
+                    charset = charsetFromContentType(content);
+                }
+                result_.charset = upperCase(charset);
+                if (stop_on_charset_ && !result_.charset.empty() && !isUtf8Compatible(result_.charset)) {
+                    return false;
+                }
             }
+            break;
+        case Tag::Title: {
+            // Title content is text up to </title>, never markup
+            size_t end = findClosingTag(html_, pos_, "</title");
+            if (!have_title_) {
+                bool title_space = false;
+                appendText(html_, pos_, end, result_.title, true, title_space);
+                have_title_ = true;
+            }
+            appendText(html_, pos_, end, result_.text, true, pending_space_);
+            pos_ = end;
+            break;
+        }
+        case Tag::Script:
+            pos_ = findClosingTag(html_, pos_, "</script");
+            break;
+        case Tag::Style:
+            pos_ = findClosingTag(html_, pos_, "</style");
+            break;
+        case Tag::Textarea:
+            // A form field's default value up to </textarea>: any markup in
+            // it is literal text, and none of it is page content
+            pos_ = findClosingTag(html_, pos_, "</textarea");
+            break;
+        case Tag::Other:
+            break;
+        }
+        return true;
+    }
+};
+
+}
+
+// HtmlParser implementation
+HtmlParser::HtmlParser() {
+}
+
+HtmlParser::~HtmlParser() {
+}
+
+ParsedHtml HtmlParser::parse(const std::string& html, const std::string& baseUrl) const {
+    ParsedHtml result;
+    if (!HtmlScanner(html, result, true).run()) {
+        // Declared charset other than UTF-8: convert and scan again
+        std::string charset = result.charset;
+        result = ParsedHtml();
+        result.charset = charset;
+        try {
+            std::string converted = boost::locale::conv::to_utf<char>(html, charset);
+            HtmlScanner(converted, result, false).run();
+        }
+        catch (...) {
+            // Conversion failed, keep original text
+            result = ParsedHtml();
+            result.charset = charset;
+            HtmlScanner(html, result, false).run();
         }
     }
-    
-    // Relative path - append to base URL
-    std::string base = baseUrl;
-    if (base.back() != '/') {
-        base += '/';
+
+    // Skip empty links, javascript, mailto, etc. and resolve relative URLs
+    std::vector<std::string> links;
+    links.reserve(result.links.size());
+    std::string resolved;
+    for (std::string& link : result.links) {
+        size_t start = link.find_first_not_of(" \t\r\n");
+        if (start == std::string::npos) {
+            continue;
+        }
+        size_t end = link.find_last_not_of(" \t\r\n");
+        link = link.substr(start, end - start + 1);
+
+        if (link.find("javascript:") == 0 || link.find("mailto:") == 0 || link[0] == '#') {
+            continue;
+        }
+
+        if (baseUrl.empty()) {
+            links.push_back(std::move(link));
+        } else if (resolveUrlReference(baseUrl, link, resolved)) {
+            links.push_back(resolved);
+        }
     }
-    return base + relativeUrl;
-}
\ No newline at end of file
+    result.links = std::move(links);
+
+    return result;
+}
+
+std::string HtmlParser::extractText(const std::string& html) {
+    return parse(html).text;
+}
+
+std::string HtmlParser::extractTitle(const std::string& html) {
+    return parse(html).title;
+}
+
+std::vector<std::string> HtmlParser::extractLinks(const std::string& html, const std::string& baseUrl) {
+    return parse(html, baseUrl).links;
+}
@@ -2,23 +2,31 @@
 
 #include <string>
 #include <vector>
-#include <regex>
+
+// Everything the spider needs from a page, collected in one scan
+struct ParsedHtml {
+    std::string title;               // first <title>, entities decoded, whitespace collapsed
+    std::string text;                // visible text, without tags, comments, scripts or styles
+    std::vector<std::string> links;  // <a href> targets, resolved against the base URL
+    std::string charset;             // declared in a <meta> tag, upper-cased; empty if none
+};
 
 class HtmlParser {
 public:
     HtmlParser();
     ~HtmlParser();
-    
+
+    // Extract title, text, links and charset in a single pass. Pages that
+    // declare a charset other than UTF-8 are converted to UTF-8 first.
+    // Thread-safe: the parser keeps no state between calls.
+    ParsedHtml parse(const std::string& html, const std::string& baseUrl = "") const;
+
     // Extract text content from HTML
     std::string extractText(const std::string& html);
-    
+
     // Extract title from HTML
     std::string extractTitle(const std::string& html);
-    
+
     // Extract all links from HTML
     std::vector<std::string> extractLinks(const std::string& html, const std::string& baseUrl = "");
-    
-private:
-    std::string removeHtmlTags(const std::string& html);
-    std::string resolveUrl(const std::string& baseUrl, const std::string& relativeUrl);
-};
\ No newline at end of file
+};
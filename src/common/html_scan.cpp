@@ -0,0 +1,323 @@
+#include "html_scan.h"
+#include <atomic>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define HTML_SCAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#ifdef HTML_SCAN_X86
+// AVX2 code is compiled for that target function by function, so the rest
+// of the build keeps running on any x86-64 CPU
+#if defined(__GNUC__) || defined(__clang__)
+#define HTML_SCAN_AVX2_TARGET __attribute__((target("avx2")))
+#define HTML_SCAN_INLINE inline __attribute__((always_inline))
+#else
+#define HTML_SCAN_AVX2_TARGET
+#define HTML_SCAN_INLINE __forceinline
+#endif
+#endif
+
+namespace {
+
+// Per-byte class bits; a space only counts as HTML_SPACE_RUN when the next
+// byte is whitespace as well, which the scanners check separately
+struct ByteClassTable {
+    unsigned char classes[256];
+
+    ByteClassTable() : classes() {
+        classes[static_cast<unsigned char>('<')] = HTML_LT;
+        classes[static_cast<unsigned char>('>')] = HTML_GT;
+        classes[static_cast<unsigned char>('&')] = HTML_AMP;
+        classes[static_cast<unsigned char>('"')] = HTML_QUOTE;
+        classes[static_cast<unsigned char>('\'')] = HTML_QUOTE;
+        classes[static_cast<unsigned char>(' ')] = HTML_SPACE;
+        classes[static_cast<unsigned char>('\t')] = HTML_SPACE | HTML_SPACE_RUN;
+        classes[static_cast<unsigned char>('\n')] = HTML_SPACE | HTML_SPACE_RUN;
+        classes[static_cast<unsigned char>('\r')] = HTML_SPACE | HTML_SPACE_RUN;
+        classes[static_cast<unsigned char>('\f')] = HTML_SPACE | HTML_SPACE_RUN;
+    }
+};
+
+const ByteClassTable BYTE_CLASSES;
+
+size_t scanScalar(const char* data, size_t size, unsigned classes) {
+    bool space_runs = (classes & HTML_SPACE_RUN) != 0;
+    for (size_t i = 0; i < size; ++i) {
+        unsigned char c = static_cast<unsigned char>(data[i]);
+        if (BYTE_CLASSES.classes[c] & classes) {
+            return i;
+        }
+        if (space_runs && c == ' ' && i + 1 < size && isHtmlSpace(static_cast<unsigned char>(data[i + 1]))) {
+            return i;
+        }
+    }
+    return size;
+}
+
+size_t skipScalar(const char* data, size_t size) {
+    size_t i = 0;
+    while (i < size && isHtmlSpace(static_cast<unsigned char>(data[i]))) {
+        ++i;
+    }
+    return i;
+}
+
+#ifdef HTML_SCAN_X86
+
+// Single bytes to compare against; unused slots repeat the first one so
+// the vector loops do not branch on the count
+struct PointBytes {
+    char bytes[4];
+    bool any;
+
+    explicit PointBytes(unsigned classes) : bytes(), any(false) {
+        int count = 0;
+        if (classes & HTML_LT) bytes[count++] = '<';
+        if (classes & HTML_GT) bytes[count++] = '>';
+        if (classes & HTML_AMP) bytes[count++] = '&';
+        if (classes & HTML_QUOTE) bytes[count++] = '"';
+        any = count > 0;
+        for (int i = count; i < 4; ++i) {
+            bytes[i] = bytes[0];
+        }
+    }
+};
+
+inline unsigned countTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+HTML_SCAN_INLINE __m128i controlSpace16(__m128i chunk) {
+    return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t')),
+                                     _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))),
+                        _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')),
+                                     _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\f'))));
+}
+
+// Hit mask of the 16 bytes at data, which must be followed by at least one
+// more byte (the lookahead for space runs). Always inlined, so the AVX2
+// kernel gets a VEX-encoded copy for its tail.
+HTML_SCAN_INLINE uint32_t hits16(const char* data, const PointBytes& points, unsigned classes) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i hits = _mm_setzero_si128();
+    if (points.any) {
+        hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(points.bytes[0])),
+                                         _mm_cmpeq_epi8(chunk, _mm_set1_epi8(points.bytes[1]))),
+                            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(points.bytes[2])),
+                                         _mm_cmpeq_epi8(chunk, _mm_set1_epi8(points.bytes[3]))));
+    }
+    // The quote class has two bytes; the second gets its own compare
+    if (classes & HTML_QUOTE) {
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\'')));
+    }
+    if (classes & (HTML_SPACE | HTML_SPACE_RUN)) {
+        __m128i blank = _mm_set1_epi8(' ');
+        __m128i blanks = _mm_cmpeq_epi8(chunk, blank);
+        __m128i control = controlSpace16(chunk);
+        if (classes & HTML_SPACE) {
+            hits = _mm_or_si128(hits, _mm_or_si128(blanks, control));
+        } else {
+            __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 1));
+            __m128i next_space = _mm_or_si128(_mm_cmpeq_epi8(next, blank), controlSpace16(next));
+            hits = _mm_or_si128(hits, _mm_or_si128(control, _mm_and_si128(blanks, next_space)));
+        }
+    }
+    return static_cast<uint32_t>(_mm_movemask_epi8(hits));
+}
+
+size_t scanSse2(const char* data, size_t size, unsigned classes) {
+    PointBytes points(classes);
+    size_t i = 0;
+    for (; i + 16 < size; i += 16) {
+        uint32_t mask = hits16(data + i, points, classes);
+        if (mask) {
+            return i + countTrailingZeros(mask);
+        }
+    }
+    return i + scanScalar(data + i, size - i, classes);
+}
+
+size_t skipSse2(const char* data, size_t size) {
+    __m128i blank = _mm_set1_epi8(' ');
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i spaces = _mm_or_si128(_mm_cmpeq_epi8(chunk, blank), controlSpace16(chunk));
+        uint32_t mask = ~static_cast<uint32_t>(_mm_movemask_epi8(spaces)) & 0xFFFFu;
+        if (mask) {
+            return i + countTrailingZeros(mask);
+        }
+    }
+    return i + skipScalar(data + i, size - i);
+}
+
+HTML_SCAN_AVX2_TARGET inline __m256i controlSpace32(__m256i chunk) {
+    return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t')),
+                                           _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))),
+                           _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r')),
+                                           _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\f'))));
+}
+
+HTML_SCAN_AVX2_TARGET size_t scanAvx2(const char* data, size_t size, unsigned classes) {
+    PointBytes points(classes);
+    bool space = (classes & HTML_SPACE) != 0;
+    bool space_runs = (classes & HTML_SPACE_RUN) != 0;
+    bool quote = (classes & HTML_QUOTE) != 0;
+
+    __m256i p0 = _mm256_set1_epi8(points.bytes[0]);
+    __m256i p1 = _mm256_set1_epi8(points.bytes[1]);
+    __m256i p2 = _mm256_set1_epi8(points.bytes[2]);
+    __m256i p3 = _mm256_set1_epi8(points.bytes[3]);
+    __m256i single_quote = _mm256_set1_epi8('\'');
+    __m256i blank = _mm256_set1_epi8(' ');
+
+    size_t i = 0;
+    for (; i + 32 < size; i += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i hits = _mm256_setzero_si256();
+        if (points.any) {
+            hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, p0), _mm256_cmpeq_epi8(chunk, p1)),
+                                   _mm256_or_si256(_mm256_cmpeq_epi8(chunk, p2), _mm256_cmpeq_epi8(chunk, p3)));
+        }
+        if (quote) {
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, single_quote));
+        }
+        if (space || space_runs) {
+            __m256i blanks = _mm256_cmpeq_epi8(chunk, blank);
+            __m256i control = controlSpace32(chunk);
+            if (space) {
+                hits = _mm256_or_si256(hits, _mm256_or_si256(blanks, control));
+            } else {
+                __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1));
+                __m256i next_space = _mm256_or_si256(_mm256_cmpeq_epi8(next, blank), controlSpace32(next));
+                hits = _mm256_or_si256(hits, _mm256_or_si256(control, _mm256_and_si256(blanks, next_space)));
+            }
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        if (mask) {
+            return i + countTrailingZeros(mask);
+        }
+    }
+    // Short scans are common (tags, words), so finish with a 16-byte step;
+    // calling the SSE2 kernel instead would mix legacy SSE with AVX code
+    if (i + 16 < size) {
+        uint32_t mask = hits16(data + i, points, classes);
+        if (mask) {
+            return i + countTrailingZeros(mask);
+        }
+        i += 16;
+    }
+    return i + scanScalar(data + i, size - i, classes);
+}
+
+HTML_SCAN_AVX2_TARGET size_t skipAvx2(const char* data, size_t size) {
+    __m256i blank = _mm256_set1_epi8(' ');
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i spaces = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, blank), controlSpace32(chunk));
+        uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(spaces));
+        if (mask) {
+            return i + countTrailingZeros(mask);
+        }
+    }
+    return i + skipScalar(data + i, size - i);
+}
+
+bool cpuHasAvx2() {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    // The OS must save the AVX registers too
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+#endif
+
+struct Kernel {
+    const char* name;
+    size_t (*scan)(const char*, size_t, unsigned);
+    size_t (*skip)(const char*, size_t);
+};
+
+const Kernel SCALAR_KERNEL = {"scalar", scanScalar, skipScalar};
+#ifdef HTML_SCAN_X86
+const Kernel SSE2_KERNEL = {"sse2", scanSse2, skipSse2};
+const Kernel AVX2_KERNEL = {"avx2", scanAvx2, skipAvx2};
+#endif
+
+const Kernel* findKernel(HtmlScanKernel kernel) {
+    switch (kernel) {
+    case HtmlScanKernel::Scalar:
+        return &SCALAR_KERNEL;
+#ifdef HTML_SCAN_X86
+    case HtmlScanKernel::SSE2:
+        // Part of x86-64
+        return &SSE2_KERNEL;
+    case HtmlScanKernel::AVX2:
+        return cpuHasAvx2() ? &AVX2_KERNEL : nullptr;
+    case HtmlScanKernel::Auto:
+        return cpuHasAvx2() ? &AVX2_KERNEL : &SSE2_KERNEL;
+#else
+    case HtmlScanKernel::Auto:
+        return &SCALAR_KERNEL;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+std::atomic<const Kernel*>& activeKernel() {
+    static std::atomic<const Kernel*> kernel(findKernel(HtmlScanKernel::Auto));
+    return kernel;
+}
+
+}
+
+size_t scanHtmlBytes(const char* data, size_t size, unsigned classes) {
+    return activeKernel().load(std::memory_order_relaxed)->scan(data, size, classes);
+}
+
+size_t skipHtmlSpace(const char* data, size_t size) {
+    return activeKernel().load(std::memory_order_relaxed)->skip(data, size);
+}
+
+bool setHtmlScanKernel(HtmlScanKernel kernel) {
+    const Kernel* found = findKernel(kernel);
+    if (!found) {
+        return false;
+    }
+    activeKernel().store(found, std::memory_order_relaxed);
+    return true;
+}
+
+const char* getHtmlScanKernelName() {
+    return activeKernel().load(std::memory_order_relaxed)->name;
+}
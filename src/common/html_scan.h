@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+
+// Byte scanning kernels for the HTML tokenizer. Most of a page is text
+// between tags, so finding the next interesting byte is the inner loop of
+// parsing; these look at 16 (SSE2) or 32 (AVX2) bytes per step, picked at
+// run time, with a scalar fallback for other CPUs.
+
+// Classes of bytes the scanner can stop at
+enum HtmlByteClass : unsigned {
+    HTML_LT = 1u << 0,          // '<'
+    HTML_GT = 1u << 1,          // '>'
+    HTML_AMP = 1u << 2,         // '&'
+    HTML_QUOTE = 1u << 3,       // '"' or '\''
+    HTML_SPACE = 1u << 4,       // space, tab, CR, LF or FF
+    HTML_SPACE_RUN = 1u << 5,   // whitespace other than a lone space: tab,
+                                // CR, LF, FF, or a space followed by whitespace
+};
+
+enum class HtmlScanKernel {
+    Auto,     // the best one the CPU supports
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+// Offset of the first byte of data that is in one of classes, or size
+size_t scanHtmlBytes(const char* data, size_t size, unsigned classes);
+
+// Offset of the first byte of data that is not whitespace, or size
+size_t skipHtmlSpace(const char* data, size_t size);
+
+// Force a kernel (for benchmarks and testing); false if the CPU or the
+// build does not support it
+bool setHtmlScanKernel(HtmlScanKernel kernel);
+
+// Name of the kernel in use
+const char* getHtmlScanKernelName();
+
+// Whitespace as the scanner sees it
+inline bool isHtmlSpace(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
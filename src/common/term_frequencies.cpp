@@ -0,0 +1,130 @@
+#include "term_frequencies.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Table size for a new or cleared table; doubles whenever it is half full
+const size_t INITIAL_SLOTS = 1024;
+
+// A cleared table larger than this shrinks back to INITIAL_SLOTS, so one
+// huge page does not make clearing slow for every page after it
+const size_t MAX_RETAINED_SLOTS = 64 * 1024;
+
+// Arena block size; a page's distinct terms usually fit in one block
+const size_t BLOCK_SIZE = 32 * 1024;
+
+}
+
+TermFrequencies::TermFrequencies()
+    : current_block_(0)
+    , block_used_(0)
+    , total_count_(0) {
+}
+
+void TermFrequencies::add(std::string_view term) {
+    if ((terms_.size() + 1) * 2 > slots_.size()) {
+        rebuildSlots(slots_.empty() ? INITIAL_SLOTS : slots_.size() * 2);
+    }
+    total_count_++;
+
+    uint64_t h = hash(term);
+    uint32_t tag = static_cast<uint32_t>(h >> 32);
+    size_t mask = slots_.size() - 1;
+    for (size_t i = static_cast<size_t>(h) & mask; ; i = (i + 1) & mask) {
+        Slot& slot = slots_[i];
+        if (slot.index == 0) {
+            terms_.push_back({store(term), 1});
+            slot.tag = tag;
+            slot.index = static_cast<uint32_t>(terms_.size());
+            return;
+        }
+        if (slot.tag == tag && terms_[slot.index - 1].term == term) {
+            terms_[slot.index - 1].frequency++;
+            return;
+        }
+    }
+}
+
+void TermFrequencies::clear() {
+    terms_.clear();
+    total_count_ = 0;
+    if (slots_.size() > MAX_RETAINED_SLOTS) {
+        slots_.assign(INITIAL_SLOTS, Slot{0, 0});
+    } else {
+        std::fill(slots_.begin(), slots_.end(), Slot{0, 0});
+    }
+    current_block_ = 0;
+    block_used_ = 0;
+}
+
+void TermFrequencies::sortByTerm() {
+    std::sort(terms_.begin(), terms_.end(),
+              [](const Term& a, const Term& b) { return a.term < b.term; });
+    rebuildSlots(std::max(slots_.size(), INITIAL_SLOTS));
+}
+
+std::string_view TermFrequencies::store(std::string_view term) {
+    if (blocks_.empty() || block_used_ + term.size() > blocks_[current_block_].size) {
+        // Move on to the next block big enough, allocating one past the end
+        size_t next = blocks_.empty() ? 0 : current_block_ + 1;
+        while (next < blocks_.size() && blocks_[next].size < term.size()) {
+            next++;
+        }
+        if (next == blocks_.size()) {
+            size_t size = std::max(BLOCK_SIZE, term.size());
+            blocks_.push_back({std::unique_ptr<char[]>(new char[size]), size});
+        }
+        current_block_ = next;
+        block_used_ = 0;
+    }
+
+    char* data = blocks_[current_block_].data.get() + block_used_;
+    if (!term.empty()) {
+        std::memcpy(data, term.data(), term.size());
+    }
+    block_used_ += term.size();
+    return std::string_view(data, term.size());
+}
+
+void TermFrequencies::rebuildSlots(size_t capacity) {
+    slots_.assign(capacity, Slot{0, 0});
+    size_t mask = capacity - 1;
+    for (size_t n = 0; n < terms_.size(); ++n) {
+        uint64_t h = hash(terms_[n].term);
+        size_t i = static_cast<size_t>(h) & mask;
+        while (slots_[i].index != 0) {
+            i = (i + 1) & mask;
+        }
+        slots_[i].tag = static_cast<uint32_t>(h >> 32);
+        slots_[i].index = static_cast<uint32_t>(n + 1);
+    }
+}
+
+uint64_t TermFrequencies::hash(std::string_view term) {
+    // Eight bytes per multiply, then a murmur3 finalizer so the low bits
+    // used for the slot depend on every byte
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ term.size();
+    const char* data = term.data();
+    size_t size = term.size();
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        h = (h ^ word) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+        data += 8;
+        size -= 8;
+    }
+    if (size > 0) {
+        // Byte by byte: a variable-length memcpy is a library call
+        uint64_t word = 0;
+        for (size_t i = 0; i < size; ++i) {
+            word |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+        }
+        h = (h ^ word) * 0xff51afd7ed558ccdULL;
+    }
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
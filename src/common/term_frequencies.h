@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// Term counts of one document: an open-addressing hash table over a flat
+// array of (term, frequency) pairs, with the term bytes copied into an
+// arena. Adding a term the table has seen is a hash and a compare; a new
+// term costs one copy into the current arena block, so indexing a page
+// allocates a handful of blocks instead of a node and a string per term.
+// clear() keeps the memory, so one table reused across documents stops
+// allocating once it has seen the largest of them.
+class TermFrequencies {
+public:
+    struct Term {
+        std::string_view term;   // points into the arena; valid until clear()
+        int frequency;
+    };
+
+    TermFrequencies();
+    TermFrequencies(TermFrequencies&&) = default;
+    TermFrequencies& operator=(TermFrequencies&&) = default;
+
+    // Count one occurrence of term
+    void add(std::string_view term);
+
+    // Forget all terms, keeping the table and arena for the next document
+    void clear();
+
+    // Terms in insertion order, or by term after sortByTerm()
+    const std::vector<Term>& getTerms() const { return terms_; }
+    size_t size() const { return terms_.size(); }
+    bool empty() const { return terms_.empty(); }
+
+    // Sum of all frequencies
+    size_t getTotalCount() const { return total_count_; }
+
+    // Order terms by their bytes; add() keeps working afterwards
+    void sortByTerm();
+
+private:
+    struct Slot {
+        uint32_t tag;     // high bits of the hash, compared before the term
+        uint32_t index;   // 1 + position in terms_; 0 for an empty slot
+    };
+
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Term> terms_;
+    std::vector<Slot> slots_;
+    std::vector<Block> blocks_;
+    size_t current_block_;
+    size_t block_used_;
+    size_t total_count_;
+
+    // Copy term into the arena
+    std::string_view store(std::string_view term);
+
+    // Re-insert every term into a table of capacity slots (a power of two)
+    void rebuildSlots(size_t capacity);
+
+    static uint64_t hash(std::string_view term);
+};
@@ -3,61 +3,224 @@
 #include <sstream>
 #include <algorithm>
 #include <cctype>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
 
-TextIndexer::TextIndexer() {
+namespace {
+
+// Distinct non-ASCII words kept per thread; the cache is emptied when it
+// fills up. Word frequencies are Zipfian, so the common ones are back
+// after a few pages.
+const size_t MAX_CACHED_WORDS = 1 << 16;
+
+// Normalized words of one indexer (its locale decides the result); a
+// thread that switches to another indexer starts the cache over
+struct NormalizationCache {
+    uint64_t owner = 0;
+    std::unordered_map<std::string, std::string> words;
+};
+
+thread_local NormalizationCache t_normalized;
+
+std::atomic<uint64_t> g_next_indexer_id(1);
+
+// Bytes that belong to a word: ASCII letters and digits, and every byte
+// of a multi-byte UTF-8 character
+struct WordByteTable {
+    bool word[256];
+
+    WordByteTable() : word() {
+        for (int c = 0; c < 256; ++c) {
+            word[c] = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+        }
+    }
+};
+
+const WordByteTable WORD_BYTES;
+
+// Call emit(word, ascii) for each word of text, in order
+template <typename Emit>
+void forEachWord(std::string_view text, Emit emit) {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(text.data());
+    size_t size = text.size();
+    size_t pos = 0;
+    while (pos < size) {
+        while (pos < size && !WORD_BYTES.word[data[pos]]) {
+            ++pos;
+        }
+        size_t start = pos;
+        unsigned char high_bits = 0;
+        while (pos < size && WORD_BYTES.word[data[pos]]) {
+            high_bits |= data[pos];
+            ++pos;
+        }
+        if (pos > start) {
+            emit(text.substr(start, pos - start), (high_bits & 0x80) == 0);
+        }
+    }
+}
+
+// Lower-case an ASCII word into out (NFD and case folding do nothing else to ASCII)
+void lowerAscii(std::string_view word, std::string& out) {
+    out.resize(word.size());
+    for (size_t i = 0; i < word.size(); ++i) {
+        char c = word[i];
+        out[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+}
+
+bool isAscii(std::string_view word) {
+    return std::all_of(word.begin(), word.end(), [](char c) { return (c & 0x80) == 0; });
+}
+
+}
+
+TextIndexer::TextIndexer()
+    : id_(g_next_indexer_id++) {
     initializeLocale();
 }
 
 TextIndexer::~TextIndexer() {
+    if (pool_) {
+        pool_->join();
+    }
 }
 
-std::map<std::string, int> TextIndexer::indexText(const std::string& text) {
-    std::map<std::string, int> wordFreq;
-    
-    std::vector<std::string> words = tokenize(text);
+std::map<std::string, int> TextIndexer::indexText(const std::string& text) const {
+    TermFrequencies terms;
+    indexText(text, terms);
     
-    for (const auto& word : words) {
-        std::string normalized = normalizeWord(word);
-        if (shouldIndexWord(normalized)) {
-            wordFreq[normalized]++;
-        }
+    std::map<std::string, int> wordFreq;
+    for (const TermFrequencies::Term& term : terms.getTerms()) {
+        wordFreq.emplace(term.term, term.frequency);
     }
-    
     return wordFreq;
 }
 
-std::vector<std::string> TextIndexer::tokenize(const std::string& text) {
-    std::vector<std::string> words;
+void TextIndexer::indexText(std::string_view text, TermFrequencies& terms) const {
+    terms.clear();
+    
+    // Words are normalized as they are found, without building a token list
+    std::string lowered;
+    forEachWord(text, [&](std::string_view word, bool ascii) {
+        if (ascii) {
+            lowerAscii(word, lowered);
+            if (shouldIndexWord(lowered)) {
+                terms.add(lowered);
+            }
+        } else {
+            const std::string& normalized = normalizeNonAscii(word);
+            if (shouldIndexWord(normalized)) {
+                terms.add(normalized);
+            }
+        }
+    });
+}
+
+void TextIndexer::indexDocuments(const std::vector<std::string_view>& documents,
+                                 std::vector<TermFrequencies>& results, unsigned threads) const {
+    results.resize(documents.size());
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<size_t>(threads, documents.size()));
     
-    // Remove punctuation and split by whitespace
-    std::string cleanText = removePunctuation(text);
+    // Workers take the next document until none are left, so long and
+    // short documents balance out
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for (size_t i = next++; i < documents.size(); i = next++) {
+            indexText(documents[i], results[i]);
+        }
+    };
     
-    std::istringstream iss(cleanText);
-    std::string word;
+    if (threads <= 1) {
+        work();
+        return;
+    }
     
-    while (iss >> word) {
-        words.push_back(word);
+    boost::asio::thread_pool& pool = getPool(threads - 1);
+    std::mutex mutex;
+    std::condition_variable done;
+    unsigned running = threads - 1;
+    for (unsigned i = 1; i < threads; ++i) {
+        boost::asio::post(pool, [&]() {
+            work();
+            // Notify under the lock: the caller's mutex and condition
+            // variable are gone as soon as it sees running reach 0
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--running == 0) {
+                done.notify_one();
+            }
+        });
     }
+    work();
     
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&running]() { return running == 0; });
+}
+
+boost::asio::thread_pool& TextIndexer::getPool(unsigned workers) const {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    if (!pool_) {
+        pool_ = std::make_unique<boost::asio::thread_pool>(workers);
+    }
+    return *pool_;
+}
+
+std::vector<std::string> TextIndexer::tokenize(const std::string& text) const {
+    std::vector<std::string> words;
+    forEachWord(text, [&words](std::string_view word, bool) {
+        words.emplace_back(word);
+    });
     return words;
 }
 
-std::string TextIndexer::normalizeWord(const std::string& word) {
+std::string TextIndexer::normalizeWord(const std::string& word) const {
+    if (isAscii(word)) {
+        std::string result;
+        lowerAscii(word, result);
+        return result;
+    }
+    return normalizeNonAscii(word);
+}
+
+const std::string& TextIndexer::normalizeNonAscii(std::string_view word) const {
+    NormalizationCache& cache = t_normalized;
+    if (cache.owner != id_) {
+        cache.words.clear();
+        cache.owner = id_;
+    }
+    
+    std::string key(word);
+    auto cached = cache.words.find(key);
+    if (cached != cache.words.end()) {
+        return cached->second;
+    }
+    
+    std::string normalized;
     try {
         // Use Boost.Locale for proper Unicode normalization
-        std::string normalized = boost::locale::normalize(word, boost::locale::norm_nfd);
-        normalized = boost::locale::fold_case(normalized);
-        return normalized;
+        normalized = boost::locale::normalize(key, boost::locale::norm_nfd, locale_);
+        normalized = boost::locale::fold_case(normalized, locale_);
     }
     catch (const std::exception& e) {
         // Fallback to simple lowercase
-        std::string result = word;
-        std::transform(result.begin(), result.end(), result.begin(), ::tolower);
-        return result;
+        normalized = key;
+        std::transform(normalized.begin(), normalized.end(), normalized.begin(), ::tolower);
+    }
+    
+    if (cache.words.size() >= MAX_CACHED_WORDS) {
+        cache.words.clear();
     }
+    return cache.words.emplace(std::move(key), std::move(normalized)).first->second;
 }
 
-bool TextIndexer::shouldIndexWord(const std::string& word) {
+bool TextIndexer::shouldIndexWord(const std::string& word) const {
     // Check word length constraints (in characters, not bytes)
     if (word.empty() || word.length() > 64) { // Increased limit for Unicode
         return false;
@@ -83,20 +246,17 @@ bool TextIndexer::shouldIndexWord(const std::string& word) {
 }
 
 void TextIndexer::initializeLocale() {
+    // Only this instance uses the locale; the global one is left alone
+    boost::locale::generator generator;
     try {
-        locale_gen_.locale_cache_enabled(true);
-        locale_gen_.generate("en_US.UTF-8");
-        locale_ = locale_gen_("en_US.UTF-8");
-
-        // Set global locale
-        std::locale::global(locale_);
+        locale_ = generator("en_US.UTF-8");
         std::cout << "Initialized locale: " << std::use_facet<boost::locale::info>(locale_).name() << std::endl;
     }
     catch (const std::exception& e) {
         std::cerr << "Locale initialization error: " << e.what() << std::endl;
         // Fallback to system locale
         try {
-            locale_ = locale_gen_("");
+            locale_ = generator("");
         }
         catch (const std::exception& e2) {
             // Use C locale as last resort
@@ -105,22 +265,3 @@ void TextIndexer::initializeLocale() {
         }
     }
 }
-
-std::string TextIndexer::removePunctuation(const std::string& text) {
-    std::string result;
-    result.reserve(text.length());
-
-    for (char c : text) {
-        // Keep Unicode characters and alphanumeric
-        if (std::isalnum(static_cast<unsigned char>(c)) ||
-            std::isspace(static_cast<unsigned char>(c)) ||
-            (c & 0x80)) { // Keep Unicode characters (high bit set)
-            result += c;
-        }
-        else {
-            result += ' '; // Replace punctuation with space
-        }
-    }
-
-    return result;
-}
\ No newline at end of file
@@ -1,31 +1,67 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
 #include <boost/locale.hpp>
+#include "term_frequencies.h"
 
+namespace boost { namespace asio { class thread_pool; } }
+
+// Splits text into normalized words and counts them. The locale used
+// for Unicode normalization belongs to the instance (the process-wide
+// locale is left alone), and every method is const and reentrant, so one
+// indexer can be shared by any number of threads.
 class TextIndexer {
 public:
     TextIndexer();
     ~TextIndexer();
     
     // Process text and return word frequency map
-    std::map<std::string, int> indexText(const std::string& text);
+    std::map<std::string, int> indexText(const std::string& text) const;
+    
+    // Count the indexable words of text into terms, clearing it first.
+    // Words are streamed straight into the table; reusing one table for
+    // many documents avoids allocating per word or per document.
+    void indexText(std::string_view text, TermFrequencies& terms) const;
+    
+    // Index each document into the matching entry of results (resized to
+    // match), spreading the documents over up to threads threads; 0 means
+    // one per hardware thread. The calling thread is one of them; the rest
+    // come from a pool started by the first call and kept, with their
+    // normalization caches, for later ones.
+    void indexDocuments(const std::vector<std::string_view>& documents,
+                        std::vector<TermFrequencies>& results, unsigned threads = 0) const;
     
-    // Tokenize text into words
-    std::vector<std::string> tokenize(const std::string& text);
+    // Tokenize text into words: runs of ASCII letters and digits and
+    // non-ASCII bytes, split at everything else
+    std::vector<std::string> tokenize(const std::string& text) const;
     
-    // Clean and normalize word
-    std::string normalizeWord(const std::string& word);
+    // Clean and normalize word: NFD and case folding. Pure ASCII words
+    // are just lower-cased; others go through Boost.Locale, with the
+    // result cached per thread.
+    std::string normalizeWord(const std::string& word) const;
     
     // Check if word should be indexed (length constraints, etc.)
-    bool shouldIndexWord(const std::string& word);
+    bool shouldIndexWord(const std::string& word) const;
     
 private:
-    boost::locale::generator locale_gen_;
     std::locale locale_;
+    uint64_t id_;   // tells this indexer's entries in the per-thread cache from another's
+    
+    mutable std::mutex pool_mutex_;
+    mutable std::unique_ptr<boost::asio::thread_pool> pool_;
+    
+    // The batch worker pool, started with workers threads on first use
+    boost::asio::thread_pool& getPool(unsigned workers) const;
     
     void initializeLocale();
-    std::string removePunctuation(const std::string& text);
-};
\ No newline at end of file
+    
+    // Normalized form of a word with non-ASCII bytes, from the calling
+    // thread's cache when it has been seen before
+    const std::string& normalizeNonAscii(std::string_view word) const;
+};
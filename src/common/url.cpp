@@ -0,0 +1,425 @@
+#include "url.h"
+
+namespace {
+
+// Query parameters beyond this many are kept in their original order
+const size_t MAX_SORTED_PARAMS = 64;
+
+const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+inline bool isAlpha(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+inline bool isDigit(unsigned char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline int hexValue(unsigned char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+inline char toLower(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : static_cast<char>(c);
+}
+
+inline bool isUnreserved(unsigned char c) {
+    return isAlpha(c) || isDigit(c) || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+// Bytes that never appear unencoded in a canonical URL
+inline bool needsEncoding(unsigned char c) {
+    return c <= 0x20 || c >= 0x7F || c == '"' || c == '<' || c == '>' || c == '\\' ||
+           c == '^' || c == '`' || c == '{' || c == '|' || c == '}';
+}
+
+// Delimiters that end URL components, as bits so one table lookup per
+// byte finds the end of any of them
+enum : unsigned char {
+    DELIM_COLON = 1,
+    DELIM_SLASH = 2,
+    DELIM_QUERY = 4,
+    DELIM_HASH = 8
+};
+
+struct DelimiterTable {
+    unsigned char classes[256];
+
+    DelimiterTable() : classes() {
+        classes[static_cast<unsigned char>(':')] = DELIM_COLON;
+        classes[static_cast<unsigned char>('/')] = DELIM_SLASH;
+        classes[static_cast<unsigned char>('?')] = DELIM_QUERY;
+        classes[static_cast<unsigned char>('#')] = DELIM_HASH;
+    }
+};
+
+const DelimiterTable DELIMITERS;
+
+// Position of the first byte at or after pos in one of the delimiter
+// classes, or the end of text (find_first_of is several times slower)
+inline size_t findDelimiter(std::string_view text, size_t pos, unsigned char classes) {
+    while (pos < text.size() && !(DELIMITERS.classes[static_cast<unsigned char>(text[pos])] & classes)) {
+        ++pos;
+    }
+    return pos;
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && static_cast<unsigned char>(text.front()) <= 0x20) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && static_cast<unsigned char>(text.back()) <= 0x20) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// Reads the normalized form of a component one byte at a time, so query
+// parameter names can be compared without building them
+class NormalizedReader {
+public:
+    explicit NormalizedReader(std::string_view text) : text_(text), pos_(0), length_(0), next_(0) {}
+
+    // Next byte, or -1 at the end
+    int next() {
+        if (next_ == length_ && !fill()) {
+            return -1;
+        }
+        return static_cast<unsigned char>(buffer_[next_++]);
+    }
+
+private:
+    std::string_view text_;
+    size_t pos_;
+    int length_;
+    int next_;
+    char buffer_[3];
+
+    bool fill() {
+        length_ = 0;
+        next_ = 0;
+        while (pos_ < text_.size() && length_ == 0) {
+            unsigned char c = static_cast<unsigned char>(text_[pos_++]);
+            if (c == '\t' || c == '\n' || c == '\r') {
+                // Browsers drop these wherever they appear
+                continue;
+            }
+            if (c == '%' && pos_ + 2 <= text_.size() &&
+                hexValue(static_cast<unsigned char>(text_[pos_])) >= 0 &&
+                hexValue(static_cast<unsigned char>(text_[pos_ + 1])) >= 0) {
+                unsigned char value = static_cast<unsigned char>(
+                    hexValue(static_cast<unsigned char>(text_[pos_])) * 16 +
+                    hexValue(static_cast<unsigned char>(text_[pos_ + 1])));
+                pos_ += 2;
+                if (isUnreserved(value)) {
+                    buffer_[length_++] = static_cast<char>(value);
+                } else {
+                    buffer_[length_++] = '%';
+                    buffer_[length_++] = HEX_DIGITS[value >> 4];
+                    buffer_[length_++] = HEX_DIGITS[value & 0x0F];
+                }
+            } else if (c == '%' || needsEncoding(c)) {
+                buffer_[length_++] = '%';
+                buffer_[length_++] = HEX_DIGITS[c >> 4];
+                buffer_[length_++] = HEX_DIGITS[c & 0x0F];
+            } else {
+                buffer_[length_++] = static_cast<char>(c);
+            }
+        }
+        return length_ > 0;
+    }
+};
+
+void appendNormalized(std::string& out, std::string_view text) {
+    NormalizedReader reader(text);
+    for (int c = reader.next(); c >= 0; c = reader.next()) {
+        out += static_cast<char>(c);
+    }
+}
+
+std::string_view paramName(std::string_view param) {
+    return param.substr(0, param.find('='));
+}
+
+bool nameLess(std::string_view a, std::string_view b) {
+    NormalizedReader left(paramName(a));
+    NormalizedReader right(paramName(b));
+    while (true) {
+        int l = left.next();
+        int r = right.next();
+        if (l != r) {
+            return l < r;
+        }
+        if (l < 0) {
+            return false;
+        }
+    }
+}
+
+void appendQuery(std::string& out, std::string_view query) {
+    std::string_view params[MAX_SORTED_PARAMS];
+    size_t count = 0;
+    bool sortable = true;
+
+    size_t start = 0;
+    while (start <= query.size()) {
+        size_t end = query.find('&', start);
+        if (end == std::string_view::npos) {
+            end = query.size();
+        }
+        if (end > start) {
+            if (count == MAX_SORTED_PARAMS) {
+                sortable = false;
+                break;
+            }
+            params[count++] = query.substr(start, end - start);
+        }
+        start = end + 1;
+    }
+
+    if (!sortable) {
+        // Too many to sort without allocating; keep them as they are
+        if (!query.empty()) {
+            out += '?';
+            appendNormalized(out, query);
+        }
+        return;
+    }
+
+    // Insertion sort: stable, so repeated names keep their value order
+    for (size_t i = 1; i < count; ++i) {
+        std::string_view param = params[i];
+        size_t j = i;
+        while (j > 0 && nameLess(param, params[j - 1])) {
+            params[j] = params[j - 1];
+            --j;
+        }
+        params[j] = param;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        out += (i == 0) ? '?' : '&';
+        appendNormalized(out, params[i]);
+    }
+}
+
+// Remove "." and ".." segments (RFC 3986 section 5.2.4) from the path that
+// starts with '/' at start and runs to the end of s, in place
+void removeDotSegments(std::string& s, size_t start) {
+    size_t end = s.size();
+    size_t read = start;
+    size_t write = start;
+
+    while (read < end) {
+        size_t segment = read + 1;
+        size_t segment_end = s.find('/', segment);
+        if (segment_end == std::string::npos) {
+            segment_end = end;
+        }
+        size_t length = segment_end - segment;
+        bool last = segment_end == end;
+
+        if (length == 1 && s[segment] == '.') {
+            if (last) {
+                s[write++] = '/';
+            }
+        } else if (length == 2 && s[segment] == '.' && s[segment + 1] == '.') {
+            if (write > start) {
+                write = s.rfind('/', write - 1);
+            }
+            if (last) {
+                s[write++] = '/';
+            }
+        } else if (write == read) {
+            write = segment_end;
+        } else {
+            for (size_t i = read; i < segment_end; ++i) {
+                s[write++] = s[i];
+            }
+        }
+        read = segment_end;
+    }
+
+    s.resize(write);
+}
+
+// Write the canonical URL with this scheme, the authority of authority and
+// the path path_prefix + path
+bool writeUrl(std::string& out, std::string_view scheme, const UrlView& authority,
+              std::string_view path_prefix, std::string_view path, std::string_view query) {
+    out.clear();
+    if (scheme.empty() || !authority.has_authority) {
+        return false;
+    }
+
+    std::string_view host = authority.host;
+    if (!host.empty() && host.back() == '.') {
+        host.remove_suffix(1);
+    }
+    if (host.empty()) {
+        return false;
+    }
+
+    for (char c : scheme) {
+        out += toLower(static_cast<unsigned char>(c));
+    }
+    out += "://";
+
+    if (!authority.userinfo.empty()) {
+        appendNormalized(out, authority.userinfo);
+        out += '@';
+    }
+
+    for (char c : host) {
+        out += toLower(static_cast<unsigned char>(c));
+    }
+
+    std::string_view port = authority.port;
+    while (port.size() > 1 && port.front() == '0') {
+        port.remove_prefix(1);
+    }
+    if (!port.empty()) {
+        bool is_default = (port == "80" && out.compare(0, 7, "http://") == 0) ||
+                          (port == "443" && out.compare(0, 8, "https://") == 0);
+        if (!is_default) {
+            out += ':';
+            out += port;
+        }
+    }
+
+    size_t path_start = out.size();
+    appendNormalized(out, path_prefix);
+    appendNormalized(out, path);
+    if (out.size() == path_start || out[path_start] != '/') {
+        out.insert(path_start, 1, '/');
+    }
+    removeDotSegments(out, path_start);
+
+    appendQuery(out, query);
+    return true;
+}
+
+}
+
+bool parseUrlReference(std::string_view text, UrlView& parts) {
+    parts = UrlView();
+    size_t pos = 0;
+
+    // Scheme: a letter, then letters, digits, '+', '-' or '.', then ':'
+    size_t colon = findDelimiter(text, 0, DELIM_COLON | DELIM_SLASH | DELIM_QUERY | DELIM_HASH);
+    if (colon < text.size() && colon > 0 && text[colon] == ':' &&
+        isAlpha(static_cast<unsigned char>(text[0]))) {
+        bool valid = true;
+        for (size_t i = 1; i < colon && valid; ++i) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            valid = isAlpha(c) || isDigit(c) || c == '+' || c == '-' || c == '.';
+        }
+        if (valid) {
+            parts.scheme = text.substr(0, colon);
+            pos = colon + 1;
+        }
+    }
+
+    if (text.compare(pos, 2, "//") == 0) {
+        pos += 2;
+        size_t end = findDelimiter(text, pos, DELIM_SLASH | DELIM_QUERY | DELIM_HASH);
+        std::string_view authority = text.substr(pos, end - pos);
+        parts.has_authority = true;
+
+        size_t at = authority.rfind('@');
+        if (at != std::string_view::npos) {
+            parts.userinfo = authority.substr(0, at);
+            authority.remove_prefix(at + 1);
+        }
+
+        std::string_view port_part;
+        if (!authority.empty() && authority.front() == '[') {
+            size_t close = authority.find(']');
+            if (close == std::string_view::npos) {
+                return false;
+            }
+            parts.host = authority.substr(0, close + 1);
+            port_part = authority.substr(close + 1);
+            if (!port_part.empty() && port_part.front() != ':') {
+                return false;
+            }
+        } else {
+            size_t port_colon = authority.rfind(':');
+            parts.host = authority.substr(0, port_colon);
+            if (port_colon != std::string_view::npos) {
+                port_part = authority.substr(port_colon);
+            }
+        }
+        if (!port_part.empty()) {
+            parts.port = port_part.substr(1);
+            for (char c : parts.port) {
+                if (!isDigit(static_cast<unsigned char>(c))) {
+                    return false;
+                }
+            }
+        }
+        pos = end;
+    }
+
+    size_t path_end = findDelimiter(text, pos, DELIM_QUERY | DELIM_HASH);
+    parts.path = text.substr(pos, path_end - pos);
+    pos = path_end;
+
+    if (pos < text.size() && text[pos] == '?') {
+        size_t query_end = findDelimiter(text, pos, DELIM_HASH);
+        parts.query = text.substr(pos + 1, query_end - pos - 1);
+        parts.has_query = true;
+        pos = query_end;
+    }
+
+    if (pos < text.size() && text[pos] == '#') {
+        parts.fragment = text.substr(pos + 1);
+        parts.has_fragment = true;
+    }
+
+    return true;
+}
+
+bool canonicalizeUrl(std::string_view url, std::string& out) {
+    UrlView parts;
+    if (!parseUrlReference(trim(url), parts)) {
+        out.clear();
+        return false;
+    }
+    return writeUrl(out, parts.scheme, parts, std::string_view(), parts.path, parts.query);
+}
+
+bool resolveUrlReference(std::string_view base, std::string_view reference, std::string& out) {
+    UrlView base_parts;
+    UrlView parts;
+    if (!parseUrlReference(trim(base), base_parts) || base_parts.scheme.empty() ||
+        !parseUrlReference(trim(reference), parts)) {
+        out.clear();
+        return false;
+    }
+
+    // RFC 3986 section 5.2.2, with the result canonicalized as it is written
+    if (!parts.scheme.empty()) {
+        return writeUrl(out, parts.scheme, parts, std::string_view(), parts.path, parts.query);
+    }
+    if (parts.has_authority) {
+        return writeUrl(out, base_parts.scheme, parts, std::string_view(), parts.path, parts.query);
+    }
+    if (parts.path.empty()) {
+        return writeUrl(out, base_parts.scheme, base_parts, std::string_view(), base_parts.path,
+                        parts.has_query ? parts.query : base_parts.query);
+    }
+    if (parts.path.front() == '/') {
+        return writeUrl(out, base_parts.scheme, base_parts, std::string_view(), parts.path, parts.query);
+    }
+
+    // Merge: the reference replaces the last segment of the base path
+    size_t last_slash = base_parts.path.rfind('/');
+    std::string_view directory = last_slash == std::string_view::npos
+        ? std::string_view()
+        : base_parts.path.substr(0, last_slash + 1);
+    return writeUrl(out, base_parts.scheme, base_parts, directory, parts.path, parts.query);
+}
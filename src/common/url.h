@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// URL parsing, resolution and canonicalization (RFC 3986), shared by the
+// HTML parser, HTTP client, URL queue and robots.txt cache. Parsing only
+// produces views into the input; resolution and canonicalization write
+// into a caller-supplied string, so reusing one string per thread keeps
+// the hot path free of allocations.
+
+// Components of a URI reference as views into the parsed text. Delimiters
+// are not included; the has_* flags tell an empty component from a
+// missing one.
+struct UrlView {
+    std::string_view scheme;
+    std::string_view userinfo;
+    std::string_view host;        // IPv6 literals keep their brackets
+    std::string_view port;
+    std::string_view path;
+    std::string_view query;
+    std::string_view fragment;
+    bool has_authority = false;
+    bool has_query = false;
+    bool has_fragment = false;
+};
+
+// Split a URI reference (absolute or relative) into its components;
+// false if it is malformed (e.g. a non-numeric port)
+bool parseUrlReference(std::string_view text, UrlView& parts);
+
+// Canonical form of an absolute URL with a host, written to out:
+// - scheme and host lower-cased, a trailing dot on the host dropped
+// - default port (80 for http, 443 for https) and empty port dropped
+// - percent-encoding hex digits upper-cased, unreserved characters
+//   decoded, and bytes not allowed in a URL (spaces, controls, non-ASCII)
+//   encoded
+// - "." and ".." path segments removed and an empty path made "/"
+// - query parameters sorted by name (values of one name keep their order)
+//   and an empty query dropped
+// - fragment dropped
+// Returns false (leaving out unspecified) if url has no scheme or host.
+bool canonicalizeUrl(std::string_view url, std::string& out);
+
+// Resolve reference against the absolute URL base (RFC 3986 section 5.2)
+// and canonicalize the result into out; false if the result is not an
+// absolute URL with a host (e.g. "mailto:" or "javascript:" references)
+bool resolveUrlReference(std::string_view base, std::string_view reference, std::string& out);
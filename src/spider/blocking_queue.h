@@ -0,0 +1,123 @@
+#pragma once
+
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+// Thread-safe FIFO used to hand work between spider pipeline stages.
+// With a capacity set, push() blocks while the queue is full so a slow
+// consumer stage holds back its producers.
+template<typename T>
+class BlockingQueue {
+public:
+    explicit BlockingQueue(size_t capacity = 0)
+        : capacity_(capacity), stopped_(false), peak_(0), full_waits_(0) {}
+
+    // Set the maximum number of queued items (0 = unbounded)
+    void setCapacity(size_t capacity) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            capacity_ = capacity;
+        }
+        not_full_.notify_all();
+    }
+
+    // Add item to the queue, waiting while it is full (ignored once the
+    // queue is stopped)
+    void push(T item) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (isFull()) {
+                full_waits_++;
+                not_full_.wait(lock, [this] { return !isFull() || stopped_; });
+            }
+            if (stopped_) {
+                return;
+            }
+            add(std::move(item));
+        }
+        condition_.notify_one();
+    }
+
+    // Add item even if the queue is full; for producers that must not
+    // block and instead throttle themselves on full()
+    void pushNoWait(T item) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopped_) {
+                return;
+            }
+            add(std::move(item));
+        }
+        condition_.notify_one();
+    }
+
+    // Get next item (blocks if empty); returns false once stopped
+    bool pop(T& item) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this] { return !queue_.empty() || stopped_; });
+
+            if (stopped_) {
+                return false;
+            }
+
+            item = std::move(queue_.front());
+            queue_.pop();
+        }
+        not_full_.notify_one();
+        return true;
+    }
+
+    // Stop the queue (unblocks waiting threads, drops pending items)
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopped_ = true;
+            queue_ = std::queue<T>();
+        }
+        condition_.notify_all();
+        not_full_.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.size();
+    }
+
+    bool full() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return isFull();
+    }
+
+    struct Stats {
+        size_t depth;        // items queued now
+        size_t peak;         // most items ever queued at once
+        size_t full_waits;   // push() calls that had to wait for room
+    };
+
+    Stats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return Stats{queue_.size(), peak_, full_waits_};
+    }
+
+private:
+    std::queue<T> queue_;
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    std::condition_variable not_full_;
+    size_t capacity_;
+    bool stopped_;
+    size_t peak_;
+    size_t full_waits_;
+
+    bool isFull() const {
+        return capacity_ > 0 && queue_.size() >= capacity_;
+    }
+
+    void add(T item) {
+        queue_.push(std::move(item));
+        peak_ = std::max(peak_, queue_.size());
+    }
+};
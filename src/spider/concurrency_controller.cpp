@@ -0,0 +1,132 @@
+#include "concurrency_controller.h"
+#include <algorithm>
+
+namespace {
+
+// Fewer samples than this say little about a site's health
+const size_t MIN_WINDOW_SAMPLES = 8;
+
+// Cut applied to the limit on congestion
+const double DECREASE_FACTOR = 0.75;
+
+// The best latency slowly forgets old windows, so a permanently slower
+// mix of hosts does not keep the limit pinned down
+const double BEST_LATENCY_DECAY = 1.01;
+
+}
+
+ConcurrencyController::ConcurrencyController()
+    : min_limit_(8)
+    , max_limit_(128)
+    , adaptive_(true)
+    , max_error_rate_(0.1)
+    , latency_tolerance_(2.0)
+    , limit_(8)
+    , slow_start_(true)
+    , samples_(0)
+    , failures_(0)
+    , latency_sum_ms_(0)
+    , peak_in_flight_(0)
+    , window_latency_ms_(0)
+    , best_latency_ms_(0)
+    , increases_(0)
+    , decreases_(0) {
+}
+
+void ConcurrencyController::configure(size_t min_limit, size_t max_limit, bool adaptive) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_limit_ = std::max<size_t>(1, max_limit);
+    min_limit_ = std::max<size_t>(1, std::min(min_limit, max_limit_));
+    adaptive_ = adaptive;
+    limit_ = adaptive_ ? min_limit_ : max_limit_;
+    slow_start_ = true;
+    samples_ = 0;
+    failures_ = 0;
+    latency_sum_ms_ = 0;
+    peak_in_flight_ = 0;
+}
+
+void ConcurrencyController::setThresholds(double max_error_rate, double latency_tolerance) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_error_rate_ = std::max(0.0, max_error_rate);
+    latency_tolerance_ = std::max(1.0, latency_tolerance);
+}
+
+bool ConcurrencyController::recordFetch(std::chrono::milliseconds latency, bool failed, size_t peak_in_flight) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!adaptive_) {
+        return false;
+    }
+
+    samples_++;
+    peak_in_flight_ = std::max(peak_in_flight_, peak_in_flight);
+    if (failed) {
+        failures_++;
+    } else {
+        // Failed fetches often end at the timeout and would skew the latency
+        latency_sum_ms_ += static_cast<double>(latency.count());
+    }
+
+    if (samples_ < std::max(MIN_WINDOW_SAMPLES, limit_)) {
+        return false;
+    }
+    return endWindow();
+}
+
+size_t ConcurrencyController::getLimit() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return limit_;
+}
+
+ConcurrencyController::Stats ConcurrencyController::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.limit = limit_;
+    stats.increases = increases_;
+    stats.decreases = decreases_;
+    stats.window_latency_ms = window_latency_ms_;
+    stats.best_latency_ms = best_latency_ms_;
+    return stats;
+}
+
+bool ConcurrencyController::endWindow() {
+    double error_rate = static_cast<double>(failures_) / samples_;
+    size_t successes = samples_ - failures_;
+    bool congested = error_rate > max_error_rate_;
+
+    if (successes > 0) {
+        window_latency_ms_ = latency_sum_ms_ / successes;
+        if (best_latency_ms_ <= 0 || window_latency_ms_ < best_latency_ms_) {
+            best_latency_ms_ = window_latency_ms_;
+        } else {
+            best_latency_ms_ *= BEST_LATENCY_DECAY;
+        }
+        if (window_latency_ms_ > best_latency_ms_ * latency_tolerance_) {
+            congested = true;
+        }
+    }
+
+    bool limited = peak_in_flight_ >= limit_;
+
+    samples_ = 0;
+    failures_ = 0;
+    latency_sum_ms_ = 0;
+    peak_in_flight_ = 0;
+
+    size_t previous = limit_;
+    if (congested) {
+        slow_start_ = false;
+        limit_ = std::max(min_limit_, static_cast<size_t>(limit_ * DECREASE_FACTOR));
+        if (limit_ < previous) {
+            decreases_++;
+        }
+    } else if (limited) {
+        limit_ = std::min(max_limit_, slow_start_ ? limit_ * 2 : limit_ + 1);
+        if (limit_ > previous) {
+            increases_++;
+        }
+    }
+
+    return limit_ != previous;
+}
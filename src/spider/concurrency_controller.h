@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <chrono>
+#include <mutex>
+
+// Adaptive limit on concurrent fetches (AIMD). Completed fetches are
+// collected into windows of about one limit's worth of samples. After each
+// window the limit grows when fetches were healthy and shrinks
+// multiplicatively when the error rate is high or latency has risen well
+// above the best latency seen, which is how overloaded sites and a busy
+// network show up. The limit starts at the minimum and doubles per window
+// (slow start) until the first decrease.
+//
+// Like a validated TCP congestion window, the limit only grows after a
+// window in which fetches in flight actually reached it: a crawl held back
+// by something else (per-host connection caps, a narrow frontier) says
+// nothing about whether more fetches would be healthy.
+class ConcurrencyController {
+public:
+    ConcurrencyController();
+
+    // Set the bounds on the limit and reset to min_limit. With adaptive
+    // off the limit stays at max_limit.
+    void configure(size_t min_limit, size_t max_limit, bool adaptive);
+
+    // Error rate in a window above which the limit is cut (default 0.1)
+    // and the latency, as a multiple of the best window, that counts as
+    // congestion (default 2.0)
+    void setThresholds(double max_error_rate, double latency_tolerance);
+
+    // Record one finished fetch. failed means a network error, timeout or a
+    // server-side overload status (5xx, 429); ordinary 4xx replies are not
+    // failures. peak_in_flight is the most fetches in flight at once since
+    // the previous call. Returns true if the limit changed.
+    bool recordFetch(std::chrono::milliseconds latency, bool failed, size_t peak_in_flight);
+
+    // Current number of fetches allowed in flight
+    size_t getLimit() const;
+
+    struct Stats {
+        size_t limit;
+        size_t increases;
+        size_t decreases;
+        double window_latency_ms;   // average latency of the last window
+        double best_latency_ms;     // lowest window average seen
+    };
+
+    Stats getStats() const;
+
+private:
+    size_t min_limit_;
+    size_t max_limit_;
+    bool adaptive_;
+    double max_error_rate_;
+    double latency_tolerance_;
+
+    size_t limit_;
+    bool slow_start_;
+
+    // Current window
+    size_t samples_;
+    size_t failures_;
+    double latency_sum_ms_;
+    size_t peak_in_flight_;
+
+    double window_latency_ms_;
+    double best_latency_ms_;
+    size_t increases_;
+    size_t decreases_;
+
+    mutable std::mutex mutex_;
+
+    // Adjust the limit from the finished window; caller holds mutex_
+    bool endWindow();
+};
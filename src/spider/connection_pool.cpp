@@ -0,0 +1,178 @@
+#include "connection_pool.h"
+#include <algorithm>
+
+void PooledConnection::close() {
+    boost::beast::error_code ec;
+    lowestLayer().socket().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+    lowestLayer().close();
+}
+
+ConnectionPool::ConnectionPool()
+    : max_per_host_(8)
+    , max_idle_total_(256)
+    , idle_timeout_(30)
+    , idle_total_(0)
+    , acquired_(0)
+    , reused_(0)
+    , idle_expired_(0) {
+}
+
+ConnectionPool::~ConnectionPool() {
+}
+
+void ConnectionPool::configure(size_t max_per_host, size_t max_idle_total, int idle_timeout_seconds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_per_host_ = std::max<size_t>(1, max_per_host);
+    max_idle_total_ = max_idle_total;
+    idle_timeout_ = std::chrono::seconds(std::max(0, idle_timeout_seconds));
+}
+
+void ConnectionPool::acquire(const std::string& key, AcquireHandler handler) {
+    std::shared_ptr<PooledConnection> connection;
+    std::vector<std::shared_ptr<PooledConnection>> closed;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        HostEntry& entry = hosts_[key];
+        expireIdle(entry, std::chrono::steady_clock::now(), closed);
+
+        if (!entry.idle.empty()) {
+            // Most recently used connection is the least likely to be stale
+            connection = std::move(entry.idle.back());
+            entry.idle.pop_back();
+            idle_total_--;
+            entry.active++;
+            acquired_++;
+            reused_++;
+        } else if (entry.active < max_per_host_) {
+            entry.active++;
+            acquired_++;
+        } else {
+            entry.waiters.push_back(std::move(handler));
+            handler = nullptr;
+        }
+    }
+
+    for (auto& stale : closed) {
+        stale->close();
+    }
+
+    if (handler) {
+        handler(std::move(connection));
+    }
+}
+
+void ConnectionPool::release(std::shared_ptr<PooledConnection> connection) {
+    AcquireHandler waiter;
+    std::vector<std::shared_ptr<PooledConnection>> closed;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        HostEntry& entry = hosts_[connection->key];
+
+        if (!entry.waiters.empty()) {
+            // Hand the connection straight to the next waiter; the slot stays taken
+            waiter = std::move(entry.waiters.front());
+            entry.waiters.pop_front();
+            acquired_++;
+            reused_++;
+        } else {
+            if (entry.active > 0) {
+                entry.active--;
+            }
+            connection->idle_since = std::chrono::steady_clock::now();
+            entry.idle.push_back(std::move(connection));
+            idle_total_++;
+
+            while (idle_total_ > max_idle_total_) {
+                evictOldestIdle(closed);
+            }
+        }
+    }
+
+    for (auto& evicted : closed) {
+        evicted->close();
+    }
+
+    if (waiter) {
+        waiter(std::move(connection));
+    }
+}
+
+void ConnectionPool::discard(const std::string& key) {
+    AcquireHandler waiter;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = hosts_.find(key);
+        if (it == hosts_.end()) {
+            return;
+        }
+
+        HostEntry& entry = it->second;
+        if (!entry.waiters.empty()) {
+            // The freed slot goes to the next waiter, which opens a new connection
+            waiter = std::move(entry.waiters.front());
+            entry.waiters.pop_front();
+            acquired_++;
+        } else {
+            if (entry.active > 0) {
+                entry.active--;
+            }
+            if (entry.active == 0 && entry.idle.empty()) {
+                hosts_.erase(it);
+            }
+        }
+    }
+
+    if (waiter) {
+        waiter(nullptr);
+    }
+}
+
+ConnectionPool::Stats ConnectionPool::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.acquired = acquired_;
+    stats.reused = reused_;
+    stats.idle_expired = idle_expired_;
+    stats.idle_connections = idle_total_;
+    return stats;
+}
+
+void ConnectionPool::expireIdle(HostEntry& entry, std::chrono::steady_clock::time_point now,
+                                std::vector<std::shared_ptr<PooledConnection>>& closed) {
+    // Idle connections are kept oldest first
+    while (!entry.idle.empty() && now - entry.idle.front()->idle_since >= idle_timeout_) {
+        closed.push_back(std::move(entry.idle.front()));
+        entry.idle.pop_front();
+        idle_total_--;
+        idle_expired_++;
+    }
+}
+
+void ConnectionPool::evictOldestIdle(std::vector<std::shared_ptr<PooledConnection>>& closed) {
+    auto oldest = hosts_.end();
+    for (auto it = hosts_.begin(); it != hosts_.end(); ++it) {
+        if (it->second.idle.empty()) {
+            continue;
+        }
+        if (oldest == hosts_.end() ||
+            it->second.idle.front()->idle_since < oldest->second.idle.front()->idle_since) {
+            oldest = it;
+        }
+    }
+
+    if (oldest == hosts_.end()) {
+        idle_total_ = 0;
+        return;
+    }
+
+    closed.push_back(std::move(oldest->second.idle.front()));
+    oldest->second.idle.pop_front();
+    idle_total_--;
+
+    if (oldest->second.active == 0 && oldest->second.idle.empty() && oldest->second.waiters.empty()) {
+        hosts_.erase(oldest);
+    }
+}
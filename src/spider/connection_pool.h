@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <chrono>
+#include <boost/beast/core.hpp>
+#include <boost/beast/ssl.hpp>
+
+// An open connection to one origin (scheme://host:port). Exactly one of
+// the two streams is set.
+struct PooledConnection {
+    std::string key;
+    std::unique_ptr<boost::beast::tcp_stream> plain_stream;
+    std::unique_ptr<boost::beast::ssl_stream<boost::beast::tcp_stream>> tls_stream;
+    std::chrono::steady_clock::time_point idle_since;
+    size_t requests_served = 0;
+
+    explicit PooledConnection(const std::string& k) : key(k) {}
+
+    boost::beast::tcp_stream& lowestLayer() {
+        return tls_stream ? boost::beast::get_lowest_layer(*tls_stream) : *plain_stream;
+    }
+
+    void close();
+};
+
+// Bounded pool of idle keep-alive connections keyed by origin. Each origin
+// may have at most max_per_host connections open (idle or in use); callers
+// over the cap wait until a connection is released or discarded.
+class ConnectionPool {
+public:
+    using AcquireHandler = std::function<void(std::shared_ptr<PooledConnection>)>;
+
+    ConnectionPool();
+    ~ConnectionPool();
+
+    // Set limits; idle_timeout_seconds bounds how long a connection is kept unused
+    void configure(size_t max_per_host, size_t max_idle_total, int idle_timeout_seconds);
+
+    // Reserve a connection slot for key. The handler receives an idle
+    // connection to reuse, or nullptr if the caller should open a new one.
+    // It runs immediately when a slot is free, otherwise on the thread that
+    // later frees one.
+    void acquire(const std::string& key, AcquireHandler handler);
+
+    // Return a healthy keep-alive connection (keeps its slot for reuse)
+    void release(std::shared_ptr<PooledConnection> connection);
+
+    // Give up a slot whose connection was closed or failed
+    void discard(const std::string& key);
+
+    struct Stats {
+        size_t acquired;
+        size_t reused;
+        size_t idle_expired;
+        size_t idle_connections;
+    };
+
+    Stats getStats() const;
+
+private:
+    struct HostEntry {
+        size_t active = 0;
+        std::deque<std::shared_ptr<PooledConnection>> idle;
+        std::deque<AcquireHandler> waiters;
+    };
+
+    std::unordered_map<std::string, HostEntry> hosts_;
+    size_t max_per_host_;
+    size_t max_idle_total_;
+    std::chrono::seconds idle_timeout_;
+    size_t idle_total_;
+
+    size_t acquired_;
+    size_t reused_;
+    size_t idle_expired_;
+
+    mutable std::mutex mutex_;
+
+    // Drop idle connections of entry that exceeded the idle timeout
+    void expireIdle(HostEntry& entry, std::chrono::steady_clock::time_point now,
+                    std::vector<std::shared_ptr<PooledConnection>>& closed);
+
+    // Evict the oldest idle connection anywhere in the pool
+    void evictOldestIdle(std::vector<std::shared_ptr<PooledConnection>>& closed);
+};
@@ -0,0 +1,268 @@
+#include "content_decoder.h"
+#include <algorithm>
+#include <cctype>
+#include <zlib.h>
+
+#ifdef HAVE_BROTLI
+#include <brotli/decode.h>
+#endif
+
+namespace {
+
+// Output is produced in steps of this size directly at the end of the body
+const size_t DECODE_CHUNK = 16 * 1024;
+
+}
+
+struct ContentDecoder::ZlibState {
+    z_stream stream;
+    bool initialized = false;
+    bool raw_retry_allowed = false;   // deflate: fall back to a raw stream on a bad header
+    std::string retry_input;          // input fed so far while a fallback is still possible
+
+    bool init(int window_bits) {
+        end();
+        stream = z_stream();
+        initialized = (inflateInit2(&stream, window_bits) == Z_OK);
+        return initialized;
+    }
+
+    void end() {
+        if (initialized) {
+            inflateEnd(&stream);
+            initialized = false;
+        }
+    }
+
+    ~ZlibState() {
+        end();
+    }
+};
+
+#ifdef HAVE_BROTLI
+struct ContentDecoder::BrotliState {
+    BrotliDecoderState* state = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+
+    ~BrotliState() {
+        if (state) {
+            BrotliDecoderDestroyInstance(state);
+        }
+    }
+};
+#else
+struct ContentDecoder::BrotliState {
+};
+#endif
+
+ContentDecoder::ContentDecoder()
+    : encoding_(Encoding::Identity)
+    , stream_end_(false)
+    , bytes_in_(0)
+    , bytes_out_(0) {
+}
+
+ContentDecoder::~ContentDecoder() {
+}
+
+const char* ContentDecoder::acceptEncoding() {
+#ifdef HAVE_BROTLI
+    return "gzip, deflate, br";
+#else
+    return "gzip, deflate";
+#endif
+}
+
+bool ContentDecoder::reset(const std::string& content_encoding) {
+    std::string encoding = content_encoding;
+    std::transform(encoding.begin(), encoding.end(), encoding.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    encoding.erase(std::remove_if(encoding.begin(), encoding.end(),
+                                  [](unsigned char c) { return std::isspace(c); }), encoding.end());
+
+    zlib_.reset();
+    brotli_.reset();
+    stream_end_ = false;
+    bytes_in_ = 0;
+    bytes_out_ = 0;
+    error_.clear();
+
+    if (encoding.empty() || encoding == "identity") {
+        encoding_ = Encoding::Identity;
+        return true;
+    }
+
+    if (encoding == "gzip" || encoding == "x-gzip") {
+        encoding_ = Encoding::Gzip;
+        zlib_ = std::make_unique<ZlibState>();
+        // 16 + MAX_WBITS: gzip wrapper
+        if (!zlib_->init(16 + MAX_WBITS)) {
+            error_ = "Cannot initialize gzip decoder";
+            return false;
+        }
+        return true;
+    }
+
+    if (encoding == "deflate") {
+        encoding_ = Encoding::Deflate;
+        zlib_ = std::make_unique<ZlibState>();
+        zlib_->raw_retry_allowed = true;
+        // "deflate" should be zlib-wrapped, but some servers send a raw stream
+        if (!zlib_->init(MAX_WBITS)) {
+            error_ = "Cannot initialize deflate decoder";
+            return false;
+        }
+        return true;
+    }
+
+#ifdef HAVE_BROTLI
+    if (encoding == "br") {
+        encoding_ = Encoding::Brotli;
+        brotli_ = std::make_unique<BrotliState>();
+        if (!brotli_->state) {
+            error_ = "Cannot initialize brotli decoder";
+            return false;
+        }
+        return true;
+    }
+#endif
+
+    error_ = "Unsupported content encoding: " + content_encoding;
+    return false;
+}
+
+bool ContentDecoder::write(const char* data, size_t size, std::string& out) {
+    bytes_in_ += size;
+
+    switch (encoding_) {
+    case Encoding::Identity:
+        out.append(data, size);
+        bytes_out_ += size;
+        return true;
+    case Encoding::Gzip:
+    case Encoding::Deflate:
+        return writeZlib(data, size, out);
+    case Encoding::Brotli:
+        return writeBrotli(data, size, out);
+    }
+
+    return false;
+}
+
+bool ContentDecoder::finish() {
+    if (encoding_ == Encoding::Identity || stream_end_) {
+        return true;
+    }
+
+    error_ = "Compressed body ended early";
+    return false;
+}
+
+bool ContentDecoder::writeZlib(const char* data, size_t size, std::string& out) {
+    if (stream_end_) {
+        // Trailing bytes after the stream are ignored
+        return true;
+    }
+
+    if (zlib_->raw_retry_allowed) {
+        // Keep everything until output shows the zlib header was right; the
+        // header may arrive split over several writes
+        zlib_->retry_input.append(data, size);
+    }
+
+    z_stream& stream = zlib_->stream;
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = static_cast<uInt>(size);
+
+    while (stream.avail_in > 0 || stream.avail_out == 0) {
+        // Inflate into spare capacity at the end of the body
+        size_t old_size = out.size();
+        out.resize(old_size + DECODE_CHUNK);
+        stream.next_out = reinterpret_cast<Bytef*>(&out[old_size]);
+        stream.avail_out = static_cast<uInt>(DECODE_CHUNK);
+
+        int result = inflate(&stream, Z_NO_FLUSH);
+        size_t produced = DECODE_CHUNK - stream.avail_out;
+        out.resize(old_size + produced);
+        bytes_out_ += produced;
+
+        if (result == Z_DATA_ERROR && zlib_->raw_retry_allowed) {
+            // Not a zlib header: restart as raw deflate on all input so far
+            std::string input;
+            input.swap(zlib_->retry_input);
+            zlib_->raw_retry_allowed = false;
+            if (!zlib_->init(-MAX_WBITS)) {
+                error_ = "Cannot initialize deflate decoder";
+                return false;
+            }
+            return writeZlib(input.data(), input.size(), out);
+        }
+
+        if (produced > 0 || result == Z_STREAM_END) {
+            zlib_->raw_retry_allowed = false;
+            zlib_->retry_input.clear();
+            zlib_->retry_input.shrink_to_fit();
+        }
+
+        if (result == Z_STREAM_END) {
+            stream_end_ = true;
+            return true;
+        }
+        if (result == Z_BUF_ERROR) {
+            // Needs more input
+            return true;
+        }
+        if (result != Z_OK) {
+            error_ = std::string("Corrupt compressed body: ") + (stream.msg ? stream.msg : "inflate failed");
+            return false;
+        }
+        if (stream.avail_in == 0 && stream.avail_out != 0) {
+            return true;
+        }
+    }
+
+    return true;
+}
+
+bool ContentDecoder::writeBrotli(const char* data, size_t size, std::string& out) {
+#ifdef HAVE_BROTLI
+    if (stream_end_) {
+        return true;
+    }
+
+    const uint8_t* next_in = reinterpret_cast<const uint8_t*>(data);
+    size_t available_in = size;
+
+    while (true) {
+        size_t old_size = out.size();
+        out.resize(old_size + DECODE_CHUNK);
+        uint8_t* next_out = reinterpret_cast<uint8_t*>(&out[old_size]);
+        size_t available_out = DECODE_CHUNK;
+
+        BrotliDecoderResult result = BrotliDecoderDecompressStream(
+            brotli_->state, &available_in, &next_in, &available_out, &next_out, nullptr);
+        size_t produced = DECODE_CHUNK - available_out;
+        out.resize(old_size + produced);
+        bytes_out_ += produced;
+
+        if (result == BROTLI_DECODER_RESULT_SUCCESS) {
+            stream_end_ = true;
+            return true;
+        }
+        if (result == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT) {
+            return true;
+        }
+        if (result == BROTLI_DECODER_RESULT_ERROR) {
+            error_ = std::string("Corrupt compressed body: ") +
+                     BrotliDecoderErrorString(BrotliDecoderGetErrorCode(brotli_->state));
+            return false;
+        }
+        // NEEDS_MORE_OUTPUT: loop with a fresh chunk
+    }
+#else
+    (void)data;
+    (void)size;
+    (void)out;
+    error_ = "Brotli support not built in";
+    return false;
+#endif
+}
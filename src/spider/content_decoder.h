@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <memory>
+
+// Streaming decoder for HTTP Content-Encoding. Compressed input is fed in
+// the chunks it arrives in and decoded output is appended straight to the
+// caller's body string, so no compressed copy of the page is kept.
+//
+// gzip and deflate use zlib; br is available when built with HAVE_BROTLI.
+class ContentDecoder {
+public:
+    ContentDecoder();
+    ~ContentDecoder();
+
+    ContentDecoder(const ContentDecoder&) = delete;
+    ContentDecoder& operator=(const ContentDecoder&) = delete;
+
+    // Value to send in Accept-Encoding
+    static const char* acceptEncoding();
+
+    // Prepare for a body with the given Content-Encoding ("" or identity
+    // passes data through). Returns false for an unsupported encoding.
+    bool reset(const std::string& content_encoding);
+
+    // Decode a chunk of the body, appending to out. Returns false on corrupt input.
+    bool write(const char* data, size_t size, std::string& out);
+
+    // Check that the body ended at the end of the compressed stream
+    bool finish();
+
+    // Bytes received / produced since reset()
+    size_t getBytesIn() const { return bytes_in_; }
+    size_t getBytesOut() const { return bytes_out_; }
+
+    const std::string& getError() const { return error_; }
+
+private:
+    enum class Encoding { Identity, Gzip, Deflate, Brotli };
+
+    struct ZlibState;
+    struct BrotliState;
+
+    Encoding encoding_;
+    std::unique_ptr<ZlibState> zlib_;
+    std::unique_ptr<BrotliState> brotli_;
+    bool stream_end_;
+    size_t bytes_in_;
+    size_t bytes_out_;
+    std::string error_;
+
+    bool writeZlib(const char* data, size_t size, std::string& out);
+    bool writeBrotli(const char* data, size_t size, std::string& out);
+};
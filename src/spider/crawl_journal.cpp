@@ -0,0 +1,195 @@
+#include "crawl_journal.h"
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_set>
+
+CrawlJournal::CrawlJournal(const std::string& path)
+    : path_(path) {
+}
+
+CrawlJournal::~CrawlJournal() {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    if (file_.is_open()) {
+        file_.close();
+    }
+}
+
+bool CrawlJournal::load(const std::string& path, Snapshot& snapshot) {
+    std::ifstream reader(path, std::ios::binary);
+    if (!reader.is_open()) {
+        std::cerr << "Cannot open checkpoint " << path << std::endl;
+        return false;
+    }
+
+    std::vector<UrlQueueItem> queued;
+    std::unordered_set<std::string> processed;
+    std::vector<std::string> processed_order;
+    size_t malformed = 0;
+
+    std::string line;
+    while (std::getline(reader, line)) {
+        if (reader.eof()) {
+            // Unterminated last line: the process died mid-write
+            break;
+        }
+        if (line.size() < 3 || line[1] != ' ') {
+            malformed++;
+            continue;
+        }
+
+        if (line[0] == 'Q') {
+            size_t space = line.find(' ', 2);
+            if (space == std::string::npos) {
+                malformed++;
+                continue;
+            }
+            int depth = std::atoi(line.c_str() + 2);
+            queued.emplace_back(line.substr(space + 1), depth);
+        } else if (line[0] == 'P') {
+            std::string url = line.substr(2);
+            if (processed.insert(url).second) {
+                processed_order.push_back(std::move(url));
+            }
+        } else if (line[0] == 'S') {
+            std::istringstream fields(line.substr(2));
+            Counters counters;
+            if (fields >> counters.pages_crawled >> counters.pages_indexed >> counters.total_words_indexed) {
+                snapshot.counters = counters;
+            }
+        } else {
+            malformed++;
+        }
+    }
+
+    if (malformed > 0) {
+        std::cerr << "Skipped " << malformed << " malformed checkpoint lines in " << path << std::endl;
+    }
+
+    snapshot.processed = std::move(processed_order);
+    snapshot.pending.clear();
+    for (UrlQueueItem& item : queued) {
+        if (processed.find(item.url) == processed.end()) {
+            snapshot.pending.push_back(std::move(item));
+        }
+    }
+
+    return true;
+}
+
+bool CrawlJournal::open(const Snapshot* snapshot) {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+
+    if (file_.is_open()) {
+        file_.close();
+    }
+
+    if (snapshot) {
+        // Write the compacted journal beside the old one and swap it in, so
+        // a crash here leaves the previous checkpoint intact
+        std::string temp_path = path_ + ".tmp";
+        {
+            std::ofstream compacted(temp_path, std::ios::binary | std::ios::trunc);
+            if (!compacted.is_open()) {
+                std::cerr << "Cannot write checkpoint " << temp_path << std::endl;
+                return false;
+            }
+
+            std::string out;
+            for (const std::string& url : snapshot->processed) {
+                out += "P ";
+                out += url;
+                out += '\n';
+            }
+            for (const UrlQueueItem& item : snapshot->pending) {
+                out += "Q ";
+                out += std::to_string(item.depth);
+                out += ' ';
+                out += item.url;
+                out += '\n';
+            }
+            appendCounters(out, snapshot->counters);
+
+            compacted.write(out.data(), static_cast<std::streamsize>(out.size()));
+            if (!compacted.flush()) {
+                std::cerr << "Cannot write checkpoint " << temp_path << std::endl;
+                return false;
+            }
+        }
+
+        std::remove(path_.c_str());
+        if (std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+            std::cerr << "Cannot replace checkpoint " << path_ << std::endl;
+            return false;
+        }
+
+        file_.open(path_, std::ios::binary | std::ios::app);
+    } else {
+        file_.open(path_, std::ios::binary | std::ios::trunc);
+    }
+
+    if (!file_.is_open()) {
+        std::cerr << "Cannot open checkpoint " << path_ << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void CrawlJournal::recordQueued(const std::vector<UrlQueueItem>& items) {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    for (const UrlQueueItem& item : items) {
+        if (item.url.find('\n') != std::string::npos) {
+            continue;
+        }
+        buffer_ += "Q ";
+        buffer_ += std::to_string(item.depth);
+        buffer_ += ' ';
+        buffer_ += item.url;
+        buffer_ += '\n';
+    }
+}
+
+void CrawlJournal::recordProcessed(const std::string& url) {
+    if (url.find('\n') != std::string::npos) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    buffer_ += "P ";
+    buffer_ += url;
+    buffer_ += '\n';
+}
+
+bool CrawlJournal::checkpoint(const Counters& counters) {
+    // Swap the buffer out so recording threads are not held up by disk I/O
+    std::string records;
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        records.swap(buffer_);
+    }
+    appendCounters(records, counters);
+
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    if (!file_.is_open()) {
+        return false;
+    }
+
+    file_.write(records.data(), static_cast<std::streamsize>(records.size()));
+    if (!file_.flush()) {
+        std::cerr << "Failed to write checkpoint " << path_ << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void CrawlJournal::appendCounters(std::string& out, const Counters& counters) {
+    out += "S ";
+    out += std::to_string(counters.pages_crawled);
+    out += ' ';
+    out += std::to_string(counters.pages_indexed);
+    out += ' ';
+    out += std::to_string(counters.total_words_indexed);
+    out += '\n';
+}
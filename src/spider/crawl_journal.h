@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include "url_queue.h"
+
+// Append-only log of crawl progress used to checkpoint and resume a crawl.
+// Every queued URL, every processed URL and periodic crawl counters are
+// recorded as text lines; checkpoint() appends only what was recorded since
+// the previous one, so its cost does not grow with the size of the crawl.
+//
+// Line formats:
+//   Q <depth> <url>                       URL added to the frontier
+//   P <url>                               URL finished
+//   S <crawled> <indexed> <words>         crawl counters
+class CrawlJournal {
+public:
+    struct Counters {
+        size_t pages_crawled = 0;
+        size_t pages_indexed = 0;
+        size_t total_words_indexed = 0;
+    };
+
+    // State rebuilt from a journal
+    struct Snapshot {
+        std::vector<std::string> processed;
+        std::vector<UrlQueueItem> pending;
+        Counters counters;
+    };
+
+    explicit CrawlJournal(const std::string& path);
+    ~CrawlJournal();
+
+    CrawlJournal(const CrawlJournal&) = delete;
+    CrawlJournal& operator=(const CrawlJournal&) = delete;
+
+    // Read the journal at path. URLs queued but never processed (including
+    // those in flight when the crawl stopped) come back as pending.
+    static bool load(const std::string& path, Snapshot& snapshot);
+
+    // Start a new journal, replacing any existing file. With a snapshot the
+    // file is written in compacted form: one line per processed URL, one per
+    // pending URL and the counters.
+    bool open(const Snapshot* snapshot = nullptr);
+
+    // Buffer records in memory; they reach disk on the next checkpoint()
+    void recordQueued(const std::vector<UrlQueueItem>& items);
+    void recordProcessed(const std::string& url);
+
+    // Append counters and everything buffered since the last checkpoint
+    bool checkpoint(const Counters& counters);
+
+    const std::string& getPath() const { return path_; }
+
+private:
+    std::string path_;
+
+    // Records not yet written
+    std::string buffer_;
+    std::mutex buffer_mutex_;
+
+    std::ofstream file_;
+    std::mutex file_mutex_;
+
+    static void appendCounters(std::string& out, const Counters& counters);
+};
@@ -0,0 +1,160 @@
+#include "dns_cache.h"
+#include <memory>
+#include <algorithm>
+
+DnsCache::DnsCache(Resolver resolver)
+    : resolver_(std::move(resolver))
+    , ttl_(300)
+    , negative_ttl_(30)
+    , max_entries_(10000)
+    , hits_(0)
+    , negative_hits_(0)
+    , misses_(0)
+    , prefetches_(0) {
+}
+
+DnsCache::~DnsCache() {
+}
+
+DnsCache::Resolver DnsCache::makeAsioResolver(boost::asio::io_context& ioc) {
+    return [&ioc](const std::string& host, const std::string& port, ResolveHandler handler) {
+        auto resolver = std::make_shared<boost::asio::ip::tcp::resolver>(ioc);
+        resolver->async_resolve(host, port,
+            [resolver, handler](boost::system::error_code ec,
+                                boost::asio::ip::tcp::resolver::results_type results) {
+                Endpoints endpoints;
+                for (const auto& entry : results) {
+                    endpoints.push_back(entry.endpoint());
+                }
+                handler(ec, std::move(endpoints));
+            });
+    };
+}
+
+void DnsCache::configure(int ttl_seconds, int negative_ttl_seconds, size_t max_entries) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ttl_ = std::chrono::seconds(std::max(0, ttl_seconds));
+    negative_ttl_ = std::chrono::seconds(std::max(0, negative_ttl_seconds));
+    max_entries_ = std::max<size_t>(1, max_entries);
+}
+
+void DnsCache::resolve(const std::string& host, const std::string& port, ResolveHandler handler) {
+    std::string key = host + ":" + port;
+    Entry cached;
+    bool cache_hit = false;
+    bool start_lookup = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = entries_.find(key);
+        if (it == entries_.end() || it->second.expires <= std::chrono::steady_clock::now()) {
+            misses_++;
+
+            // Join the lookup already in progress, if any
+            std::vector<ResolveHandler>& waiters = pending_[key];
+            bool lookup_running = !waiters.empty() || prefetching_.count(key) > 0;
+            waiters.push_back(std::move(handler));
+            start_lookup = !lookup_running;
+        } else {
+            cache_hit = true;
+            cached = it->second;
+            if (cached.error) {
+                negative_hits_++;
+            } else {
+                hits_++;
+            }
+        }
+    }
+
+    if (start_lookup) {
+        startLookup(key, host, port);
+    } else if (cache_hit) {
+        handler(cached.error, std::move(cached.endpoints));
+    }
+}
+
+void DnsCache::prefetch(const std::string& host, const std::string& port) {
+    std::string key = host + ":" + port;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = entries_.find(key);
+        if (it != entries_.end() && it->second.expires > std::chrono::steady_clock::now()) {
+            return;
+        }
+
+        if (pending_.count(key) > 0 || prefetching_.count(key) > 0) {
+            return;
+        }
+
+        prefetches_++;
+        prefetching_.insert(key);
+    }
+
+    startLookup(key, host, port);
+}
+
+DnsCache::Stats DnsCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.hits = hits_;
+    stats.negative_hits = negative_hits_;
+    stats.misses = misses_;
+    stats.prefetches = prefetches_;
+    stats.entries = entries_.size();
+    return stats;
+}
+
+void DnsCache::startLookup(const std::string& key, const std::string& host, const std::string& port) {
+    resolver_(host, port, [this, key](boost::system::error_code ec, Endpoints endpoints) {
+        onLookupComplete(key, ec, std::move(endpoints));
+    });
+}
+
+void DnsCache::onLookupComplete(const std::string& key, boost::system::error_code ec, Endpoints endpoints) {
+    std::vector<ResolveHandler> waiters;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = std::chrono::steady_clock::now();
+
+        if (!ec && endpoints.empty()) {
+            ec = boost::asio::error::host_not_found;
+        }
+
+        if (entries_.size() >= max_entries_) {
+            evictExpired(now);
+        }
+        if (entries_.size() >= max_entries_) {
+            entries_.erase(entries_.begin());
+        }
+
+        Entry& entry = entries_[key];
+        entry.error = ec;
+        entry.endpoints = endpoints;
+        entry.expires = now + (ec ? negative_ttl_ : ttl_);
+
+        auto pending_it = pending_.find(key);
+        if (pending_it != pending_.end()) {
+            waiters = std::move(pending_it->second);
+            pending_.erase(pending_it);
+        }
+        prefetching_.erase(key);
+    }
+
+    for (auto& waiter : waiters) {
+        waiter(ec, endpoints);
+    }
+}
+
+void DnsCache::evictExpired(std::chrono::steady_clock::time_point now) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.expires <= now) {
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <mutex>
+#include <chrono>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/system/error_code.hpp>
+
+// Thread-safe cache of host name lookups shared by all fetches.
+// Successful lookups are kept for the TTL, failures for the (shorter)
+// negative TTL, and concurrent lookups of one host share a single query.
+class DnsCache {
+public:
+    using Endpoints = std::vector<boost::asio::ip::tcp::endpoint>;
+    using ResolveHandler = std::function<void(boost::system::error_code, Endpoints)>;
+
+    // Performs one real lookup and invokes the handler exactly once.
+    // Replaceable so the cache can be exercised against a stub.
+    using Resolver = std::function<void(const std::string& host, const std::string& port,
+                                        ResolveHandler handler)>;
+
+    explicit DnsCache(Resolver resolver);
+    ~DnsCache();
+
+    // Resolver backed by boost::asio::ip::tcp::resolver on ioc
+    static Resolver makeAsioResolver(boost::asio::io_context& ioc);
+
+    // Set cache lifetimes (in seconds) and the maximum number of hosts kept
+    void configure(int ttl_seconds, int negative_ttl_seconds, size_t max_entries);
+
+    // Resolve host:port. The handler runs immediately on a cache hit,
+    // otherwise on the thread that completes the lookup.
+    void resolve(const std::string& host, const std::string& port, ResolveHandler handler);
+
+    // Start a lookup in the background unless host:port is cached or pending
+    void prefetch(const std::string& host, const std::string& port);
+
+    struct Stats {
+        size_t hits;
+        size_t negative_hits;
+        size_t misses;
+        size_t prefetches;
+        size_t entries;
+    };
+
+    Stats getStats() const;
+
+private:
+    struct Entry {
+        boost::system::error_code error;
+        Endpoints endpoints;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    Resolver resolver_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::unordered_map<std::string, std::vector<ResolveHandler>> pending_;
+    std::unordered_set<std::string> prefetching_;
+    std::chrono::seconds ttl_;
+    std::chrono::seconds negative_ttl_;
+    size_t max_entries_;
+
+    size_t hits_;
+    size_t negative_hits_;
+    size_t misses_;
+    size_t prefetches_;
+
+    mutable std::mutex mutex_;
+
+    // Run the resolver for key (called without mutex_ held)
+    void startLookup(const std::string& key, const std::string& host, const std::string& port);
+
+    void onLookupComplete(const std::string& key, boost::system::error_code ec, Endpoints endpoints);
+
+    void evictExpired(std::chrono::steady_clock::time_point now);
+};
@@ -1,82 +1,578 @@
 #include "http_client.h"
+#include "../common/url.h"
 #include <iostream>
-#include <regex>
-#include <type_traits>
+#include <algorithm>
+#include <future>
+#include <array>
+#include <boost/beast/core/bind_handler.hpp>
+#include <boost/algorithm/string.hpp>
+#include <sstream>
 
-HttpClient::HttpClient() 
+namespace {
+
+const int MAX_REDIRECTS = 5;
+
+// Fill status, content type, validators and redirect target from a response header
+void readResponseHeader(const http::response_header<>& header, HttpResponse& response) {
+    response.status_code = static_cast<int>(header.result_int());
+    response.success = (response.status_code >= 200 && response.status_code < 300);
+
+    // Extract content type
+    auto content_type_it = header.find(http::field::content_type);
+    if (content_type_it != header.end()) {
+        response.content_type = std::string(content_type_it->value());
+    }
+
+    auto etag_it = header.find(http::field::etag);
+    if (etag_it != header.end()) {
+        response.etag = std::string(etag_it->value());
+    }
+    auto last_modified_it = header.find(http::field::last_modified);
+    if (last_modified_it != header.end()) {
+        response.last_modified = std::string(last_modified_it->value());
+    }
+    response.not_modified = (response.status_code == 304);
+
+    // Handle redirects (simple implementation)
+    if (response.status_code >= 300 && response.status_code < 400 && !response.not_modified) {
+        auto location_it = header.find(http::field::location);
+        if (location_it != header.end()) {
+            response.redirect_location = std::string(location_it->value());
+        }
+    }
+}
+
+// HTTP message for a WARC record: the received header with the decoded body,
+// without the transfer and content codings that no longer apply
+std::string buildCapturedMessage(const http::response_header<>& header, const std::string& body) {
+    http::response<http::string_body> message;
+    message.result(header.result_int());
+    message.version(header.version());
+    for (const auto& field : header) {
+        if (field.name() == http::field::content_encoding ||
+            field.name() == http::field::transfer_encoding ||
+            field.name() == http::field::content_length) {
+            continue;
+        }
+        message.insert(field.name_string(), field.value());
+    }
+    message.body() = body;
+    message.prepare_payload();
+
+    std::ostringstream stream;
+    stream << message;
+    return stream.str();
+}
+
+}
+
+// One in-flight request. The session keeps itself alive through
+// shared_from_this() until the handler runs. Connections come from the
+// client's pool and are returned to it when the server allows keep-alive.
+class HttpClient::FetchSession : public std::enable_shared_from_this<HttpClient::FetchSession> {
+public:
+    FetchSession(HttpClient& client, const FetchOptions& options, ResponseHandler handler)
+        : client_(client)
+        , handler_(std::move(handler))
+        , options_(options)
+        , strand_(net::make_strand(client.ioc_))
+        , attempts_(0)
+        , holds_slot_(false)
+        , reused_connection_(false) {
+    }
+
+    void start(const std::string& url) {
+        current_url_ = url;
+        ++attempts_;
+
+        try {
+            parts_ = client_.parseUrl(current_url_);
+        } catch (const std::exception& e) {
+            fail(std::string("HTTP request failed: ") + e.what());
+            return;
+        }
+
+        if (parts_.scheme.empty() || parts_.host.empty()) {
+            fail("Invalid URL format: " + current_url_);
+            return;
+        }
+
+        pool_key_ = parts_.scheme + "://" + parts_.host + ":" + parts_.port;
+
+        auto self = shared_from_this();
+        client_.connection_pool_.acquire(pool_key_, [self](std::shared_ptr<PooledConnection> connection) {
+            net::post(self->strand_, [self, connection]() {
+                self->onConnectionAcquired(connection);
+            });
+        });
+    }
+
+private:
+    HttpClient& client_;
+    ResponseHandler handler_;
+    FetchOptions options_;
+    net::strand<net::io_context::executor_type> strand_;
+    DnsCache::Endpoints endpoints_;
+    std::shared_ptr<PooledConnection> connection_;
+    beast::flat_buffer buffer_;
+    http::request<http::empty_body> req_;
+    std::unique_ptr<http::response_parser<http::buffer_body>> parser_;
+    std::array<char, 16 * 1024> body_chunk_;
+    ContentDecoder decoder_;
+    HttpResponse response_;
+    UrlParts parts_;
+    std::string current_url_;
+    std::string pool_key_;
+    int attempts_;
+    bool holds_slot_;
+    bool reused_connection_;
+
+    // Run fn against whichever stream type this request uses
+    template<typename Fn>
+    void withStream(Fn&& fn) {
+        if (connection_->tls_stream) {
+            fn(*connection_->tls_stream);
+        } else {
+            fn(*connection_->plain_stream);
+        }
+    }
+
+    void onConnectionAcquired(std::shared_ptr<PooledConnection> connection) {
+        holds_slot_ = true;
+
+        if (connection) {
+            connection_ = std::move(connection);
+            reused_connection_ = true;
+            sendRequest();
+            return;
+        }
+
+        openConnection();
+    }
+
+    void openConnection() {
+        reused_connection_ = false;
+
+        auto self = shared_from_this();
+        client_.dns_cache_.resolve(parts_.host, parts_.port,
+            [self](beast::error_code ec, DnsCache::Endpoints endpoints) {
+                net::post(self->strand_, [self, ec, endpoints]() {
+                    self->onResolve(ec, endpoints);
+                });
+            });
+    }
+
+    void onResolve(beast::error_code ec, const DnsCache::Endpoints& endpoints) {
+        if (ec) {
+            fail("HTTP request failed: resolve: " + ec.message());
+            return;
+        }
+
+        endpoints_ = endpoints;
+
+        connection_ = std::make_shared<PooledConnection>(pool_key_);
+
+        if (parts_.is_https) {
+            connection_->tls_stream = std::make_unique<beast::ssl_stream<beast::tcp_stream>>(strand_, client_.ssl_ctx_);
+
+            // Set SNI hostname
+            if (!SSL_set_tlsext_host_name(connection_->tls_stream->native_handle(), parts_.host.c_str())) {
+                beast::error_code sni_ec{static_cast<int>(::ERR_get_error()), net::error::get_ssl_category()};
+                fail("HTTP request failed: SNI: " + sni_ec.message());
+                return;
+            }
+
+            // Offer a saved session so the server can skip the full handshake
+            client_.tls_session_cache_.apply(pool_key_, connection_->tls_stream->native_handle());
+        } else {
+            connection_->plain_stream = std::make_unique<beast::tcp_stream>(strand_);
+        }
+
+        connection_->lowestLayer().expires_after(std::chrono::seconds(client_.timeout_seconds_));
+        connection_->lowestLayer().async_connect(endpoints_,
+            beast::bind_front_handler(&FetchSession::onConnect, shared_from_this()));
+    }
+
+    void onConnect(beast::error_code ec, tcp::endpoint) {
+        if (ec) {
+            fail("HTTP request failed: connect: " + ec.message());
+            return;
+        }
+
+        if (connection_->tls_stream) {
+            connection_->lowestLayer().expires_after(std::chrono::seconds(client_.timeout_seconds_));
+            connection_->tls_stream->async_handshake(ssl::stream_base::client,
+                beast::bind_front_handler(&FetchSession::onHandshake, shared_from_this()));
+        } else {
+            sendRequest();
+        }
+    }
+
+    void onHandshake(beast::error_code ec) {
+        if (ec) {
+            fail("HTTP request failed: handshake: " + ec.message());
+            return;
+        }
+
+        client_.tls_session_cache_.recordHandshake(connection_->tls_stream->native_handle());
+
+        sendRequest();
+    }
+
+    void sendRequest() {
+        // Set up an HTTP GET request message (HTTP/1.1 keeps the connection alive by default)
+        req_ = {};
+        req_.method(http::verb::get);
+        req_.target(parts_.path);
+        req_.version(11);
+        req_.set(http::field::host, parts_.host);
+        req_.set(http::field::user_agent, client_.user_agent_);
+        req_.set(http::field::accept, "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
+        req_.set(http::field::accept_language, "en-US,en;q=0.5");
+        req_.set(http::field::accept_encoding, ContentDecoder::acceptEncoding());
+        for (const auto& header : options_.headers) {
+            req_.set(header.first, header.second);
+        }
+
+        connection_->lowestLayer().expires_after(std::chrono::seconds(client_.timeout_seconds_));
+        withStream([this](auto& stream) {
+            http::async_write(stream, req_,
+                beast::bind_front_handler(&FetchSession::onWrite, shared_from_this()));
+        });
+    }
+
+    void onWrite(beast::error_code ec, std::size_t) {
+        if (ec) {
+            if (retryStaleConnection()) {
+                return;
+            }
+            fail("HTTP request failed: write: " + ec.message());
+            return;
+        }
+
+        // Read the header first; the body is then streamed through the decoder in chunks
+        buffer_.clear();
+        parser_ = std::make_unique<http::response_parser<http::buffer_body>>();
+        parser_->body_limit(boost::none);   // the size cap applies to the decoded body instead
+        connection_->lowestLayer().expires_after(std::chrono::seconds(client_.timeout_seconds_));
+        withStream([this](auto& stream) {
+            http::async_read_header(stream, buffer_, *parser_,
+                beast::bind_front_handler(&FetchSession::onReadHeader, shared_from_this()));
+        });
+    }
+
+    void onReadHeader(beast::error_code ec, std::size_t bytes_transferred) {
+        client_.bytes_received_ += bytes_transferred;
+
+        if (ec) {
+            if (bytes_transferred == 0 && retryStaleConnection()) {
+                return;
+            }
+            fail("HTTP request failed: read: " + ec.message());
+            return;
+        }
+
+        const auto& header = parser_->get();
+        response_ = HttpResponse();
+
+        readResponseHeader(header, response_);
+
+        // Decide from the header alone whether the body is worth downloading
+        if (response_.success && !options_.any_content_type &&
+            !client_.isAcceptedContentType(response_.content_type)) {
+            abortBody();
+            response_.body_skipped = true;
+            finish(std::move(response_));
+            return;
+        }
+
+        auto content_length = parser_->content_length();
+        if (client_.max_body_bytes_ > 0 && content_length && *content_length > client_.max_body_bytes_) {
+            abortBody();
+            fail("Response body too large: " + std::to_string(*content_length) + " bytes");
+            return;
+        }
+
+        std::string content_encoding;
+        auto content_encoding_it = header.find(http::field::content_encoding);
+        if (content_encoding_it != header.end()) {
+            content_encoding = std::string(content_encoding_it->value());
+        }
+        if (!decoder_.reset(content_encoding)) {
+            fail("HTTP request failed: " + decoder_.getError());
+            return;
+        }
+
+        readBody();
+    }
+
+    void readBody() {
+        if (parser_->is_done()) {
+            onBodyComplete();
+            return;
+        }
+
+        auto& body = parser_->get().body();
+        body.data = body_chunk_.data();
+        body.size = body_chunk_.size();
+
+        connection_->lowestLayer().expires_after(std::chrono::seconds(client_.timeout_seconds_));
+        withStream([this](auto& stream) {
+            http::async_read_some(stream, buffer_, *parser_,
+                beast::bind_front_handler(&FetchSession::onReadBody, shared_from_this()));
+        });
+    }
+
+    void onReadBody(beast::error_code ec, std::size_t bytes_transferred) {
+        client_.bytes_received_ += bytes_transferred;
+
+        // The chunk buffer filled up; that is the normal way a read ends here
+        if (ec == http::error::need_buffer) {
+            ec = {};
+        }
+        if (ec) {
+            fail("HTTP request failed: read: " + ec.message());
+            return;
+        }
+
+        size_t received = body_chunk_.size() - parser_->get().body().size;
+        size_t decoded_before = response_.body.size();
+        if (received > 0 && !decoder_.write(body_chunk_.data(), received, response_.body)) {
+            fail("HTTP request failed: " + decoder_.getError());
+            return;
+        }
+        client_.bytes_decoded_ += response_.body.size() - decoded_before;
+
+        if (client_.max_body_bytes_ > 0 && response_.body.size() > client_.max_body_bytes_) {
+            abortBody();
+            fail("Response body too large: over " + std::to_string(client_.max_body_bytes_) + " bytes");
+            return;
+        }
+
+        readBody();
+    }
+
+    void onBodyComplete() {
+        if (!decoder_.finish()) {
+            fail("HTTP request failed: " + decoder_.getError());
+            return;
+        }
+
+        if (client_.capture_) {
+            client_.capture_->writeResponse(current_url_, buildCapturedMessage(parser_->get(), response_.body));
+        }
+
+        // Save the session once per connection; by now any TLS 1.3 tickets have arrived
+        if (connection_->tls_stream && connection_->requests_served == 0) {
+            client_.tls_session_cache_.store(pool_key_, connection_->tls_stream->native_handle());
+        }
+
+        connection_->requests_served++;
+        if (parser_->get().keep_alive() && buffer_.size() == 0) {
+            releaseConnection();
+        } else {
+            discardConnection();
+        }
+        parser_.reset();
+
+        HttpResponse response = std::move(response_);
+
+        if (response.success || response.not_modified || response.status_code < 300 || response.status_code >= 400) {
+            finish(std::move(response));
+            return;
+        }
+
+        if (response.redirect_location.empty()) {
+            response.error_message = "Redirect response with no location header.";
+            finish(std::move(response));
+            return;
+        }
+
+        if (attempts_ >= MAX_REDIRECTS) {
+            response.error_message = "Too many redirects.";
+            finish(std::move(response));
+            return;
+        }
+
+        std::string location;
+        if (!resolveUrlReference(current_url_, response.redirect_location, location)) {
+            response.error_message = "Invalid redirect location: " + response.redirect_location;
+            finish(std::move(response));
+            return;
+        }
+        
+        // Validators belong to the original URL
+        options_.headers.clear();
+        start(location);
+    }
+
+    // A pooled connection may have been closed by the server while idle;
+    // retry once on a fresh connection, keeping the same pool slot
+    bool retryStaleConnection() {
+        if (!reused_connection_) {
+            return false;
+        }
+
+        connection_->close();
+        connection_.reset();
+        openConnection();
+        return true;
+    }
+
+    // Stop reading the current response; the rest of its body is left on
+    // the wire, so the connection cannot be reused
+    void abortBody() {
+        client_.early_aborts_++;
+
+        auto content_length = parser_->content_length_remaining();
+        if (content_length) {
+            client_.bytes_saved_ += static_cast<size_t>(*content_length);
+        }
+
+        discardConnection();
+        parser_.reset();
+    }
+
+    void releaseConnection() {
+        holds_slot_ = false;
+        client_.connection_pool_.release(std::move(connection_));
+    }
+
+    void discardConnection() {
+        if (connection_) {
+            connection_->close();
+            connection_.reset();
+        }
+        if (holds_slot_) {
+            holds_slot_ = false;
+            client_.connection_pool_.discard(pool_key_);
+        }
+    }
+
+    void fail(const std::string& message) {
+        discardConnection();
+
+        HttpResponse response;
+        response.error_message = message;
+        finish(std::move(response));
+    }
+
+    void finish(HttpResponse response) {
+        response.final_url = current_url_;
+        client_.in_flight_--;
+        ResponseHandler handler = std::move(handler_);
+        handler(std::move(response));
+    }
+};
+
+HttpClient::HttpClient(int io_threads)
     : timeout_seconds_(30)
     , user_agent_("SearchEngine-Spider/1.0")
-    , ssl_ctx_(ssl::context::tlsv12_client) {
+    , ssl_ctx_(ssl::context::tlsv12_client)
+    , work_guard_(net::make_work_guard(ioc_))
+    , dns_cache_(DnsCache::makeAsioResolver(ioc_))
+    , in_flight_(0)
+    , max_body_bytes_(0)
+    , bytes_received_(0)
+    , bytes_decoded_(0)
+    , early_aborts_(0)
+    , bytes_saved_(0) {
     
     // Configure SSL context
     ssl_ctx_.set_default_verify_paths();
     ssl_ctx_.set_verify_mode(ssl::verify_none); // For simplicity, don't verify certificates
+    SSL_CTX_set_session_cache_mode(ssl_ctx_.native_handle(), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+
+    if (io_threads < 1) {
+        io_threads = 1;
+    }
+
+    for (int i = 0; i < io_threads; ++i) {
+        io_threads_.emplace_back([this] { ioc_.run(); });
+    }
 }
 
 HttpClient::~HttpClient() {
+    work_guard_.reset();
+    ioc_.stop();
+
+    for (auto& thread : io_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
 }
 
 HttpResponse HttpClient::get(const std::string& url) {
-    HttpResponse response;
-    response.success = false;
-
-    std::string currentUrl = url;
-    const int MAX_REDIRECTS = 5;
-
-    for (int i = 0; i < MAX_REDIRECTS; ++i)
-    {
-        try
-        {
-            UrlParts Parts = parseUrl(currentUrl);
-            if (Parts.scheme.empty() || Parts.host.empty())
-            {
-                response.error_message = "Invalid URL format: " + currentUrl;
-                response.success = false;
-
-                return response;
-            }
+    auto promise = std::make_shared<std::promise<HttpResponse>>();
+    std::future<HttpResponse> result = promise->get_future();
 
-            if (Parts.is_https)
-            {
-                response = performHttpsRequest(Parts);
-            }
-            else
-            {
-                response = performHttpRequest(Parts);
-            }
+    fetchAsync(url, [promise](HttpResponse response) {
+        promise->set_value(std::move(response));
+    });
 
-            if (response.success || response.status_code < 300 || response.status_code >= 400)
-            {
-                break;
-            }
+    return result.get();
+}
 
-            if (!response.redirect_location.empty())
-            {
-                std::string prevUrl = currentUrl;
-                currentUrl = resolveUrl(prevUrl, response.redirect_location);
-            }
-            else
-            {
-                response.error_message = "Redirect response with no location header.";
-                response.success = false;
-                break;
-            }
-        }
-        catch (const std::exception& e)
-        {
-            response.error_message = std::string("HTTP request failed: ") + e.what();
-            response.success = false;
-            return response;
-        } 
+void HttpClient::fetchAsync(const std::string& url, ResponseHandler handler) {
+    fetchAsync(url, RequestHeaders(), std::move(handler));
+}
+
+void HttpClient::fetchAsync(const std::string& url, const RequestHeaders& headers, ResponseHandler handler) {
+    FetchOptions options;
+    options.headers = headers;
+    fetchAsync(url, options, std::move(handler));
+}
+
+void HttpClient::fetchAsync(const std::string& url, const FetchOptions& options, ResponseHandler handler) {
+    in_flight_++;
+
+    if (replay_archive_) {
+        net::post(ioc_, [this, url, options, handler]() {
+            HttpResponse response = replay(url, options);
+            in_flight_--;
+            handler(std::move(response));
+        });
+        return;
     }
 
-    if (response.status_code >= 300 && response.status_code < 400)
-    {
-        response.error_message = "Too many redirects.";
-        response.success = false;
+    auto session = std::make_shared<FetchSession>(*this, options, std::move(handler));
+    session->start(url);
+}
+
+size_t HttpClient::getInFlightCount() const {
+    return in_flight_.load();
+}
+
+void HttpClient::setConnectionLimits(size_t max_per_host, size_t max_idle_total, int idle_timeout_seconds) {
+    connection_pool_.configure(max_per_host, max_idle_total, idle_timeout_seconds);
+}
+
+ConnectionPool::Stats HttpClient::getConnectionPoolStats() const {
+    return connection_pool_.getStats();
+}
+
+TlsSessionCache::Stats HttpClient::getTlsSessionStats() const {
+    return tls_session_cache_.getStats();
+}
+
+void HttpClient::setDnsCacheOptions(int ttl_seconds, int negative_ttl_seconds, size_t max_entries) {
+    dns_cache_.configure(ttl_seconds, negative_ttl_seconds, max_entries);
+}
+
+void HttpClient::prefetchHost(const std::string& url) {
+    if (replay_archive_) {
+        return;
+    }
+
+    UrlParts parts = parseUrl(url);
+    if (!parts.host.empty()) {
+        dns_cache_.prefetch(parts.host, parts.port);
     }
+}
 
-    return response;
+DnsCache::Stats HttpClient::getDnsCacheStats() const {
+    return dns_cache_.getStats();
 }
 
 void HttpClient::setTimeout(int timeout_seconds) {
@@ -87,162 +583,170 @@ void HttpClient::setUserAgent(const std::string& user_agent) {
     user_agent_ = user_agent;
 }
 
-HttpClient::UrlParts HttpClient::parseUrl(const std::string& url) {
-    UrlParts parts;
-    
-    // Parse URL using regex
-    std::regex url_regex(R"(^(https?):\/\/([^:\/]+)(?::(\d+))?(.*)$)");
-    std::smatch match;
-    
-    if (std::regex_match(url, match, url_regex)) {
-        parts.scheme = match[1].str();
-        parts.host = match[2].str();
-        parts.port = match[3].str();
-        parts.path = match[4].str();
-        
-        if (parts.path.empty()) {
-            parts.path = "/";
-        }
-        
-        if (parts.port.empty()) {
-            parts.port = (parts.scheme == "https") ? "443" : "80";
+const std::string& HttpClient::getUserAgent() const {
+    return user_agent_;
+}
+
+void HttpClient::setAcceptedContentTypes(const std::vector<std::string>& content_types) {
+    accepted_content_types_.clear();
+    for (const auto& content_type : content_types) {
+        if (!content_type.empty()) {
+            accepted_content_types_.push_back(boost::algorithm::to_lower_copy(content_type));
         }
-        
-        parts.is_https = (parts.scheme == "https");
     }
-    
-    return parts;
 }
 
-HttpResponse HttpClient::performHttpRequest(const UrlParts& url_parts) {
-    net::io_context ioc;
-    tcp::resolver resolver(ioc);
-    tcp::socket socket(ioc);
-    
-    // Resolve the host
-    auto const results = resolver.resolve(url_parts.host, url_parts.port);
-    
-    // Connect to the server
-    net::connect(socket, results.begin(), results.end());
-    
-    return executeRequest(socket, url_parts);
+void HttpClient::setMaxBodySize(size_t max_bytes) {
+    max_body_bytes_ = max_bytes;
 }
 
-HttpResponse HttpClient::performHttpsRequest(const UrlParts& url_parts) {
-    net::io_context ioc;
-    tcp::resolver resolver(ioc);
-    ssl::stream<tcp::socket> stream(ioc, ssl_ctx_);
-    
-    // Set SNI hostname
-    if (!SSL_set_tlsext_host_name(stream.native_handle(), url_parts.host.c_str())) {
-        beast::error_code ec{static_cast<int>(::ERR_get_error()), net::error::get_ssl_category()};
-        throw beast::system_error{ec};
+bool HttpClient::isAcceptedContentType(const std::string& content_type) const {
+    if (accepted_content_types_.empty()) {
+        return true;
     }
-    
-    // Resolve the host
-    auto const results = resolver.resolve(url_parts.host, url_parts.port);
-    
-    // Connect to the server
-    net::connect(stream.next_layer(), results.begin(), results.end());
-    
-    // Perform SSL handshake
-    stream.handshake(ssl::stream_base::client);
-    
-    return executeRequest(stream, url_parts);
-}
 
-std::string HttpClient::resolveUrl(const std::string& baseUrl, const std::string& relativeUrl)
-{
-    if (relativeUrl.rfind("http://", 0) == 0 || relativeUrl.rfind("https://", 0) == 0)
-    {
-        return relativeUrl;
-    }
-    size_t protocolEnd = baseUrl.find("://");
-    
-    if (protocolEnd == std::string::npos)
-    {
-        return relativeUrl;
+    std::string media_type = boost::algorithm::to_lower_copy(content_type);
+    boost::algorithm::trim(media_type);
+    for (const auto& accepted : accepted_content_types_) {
+        if (media_type.compare(0, accepted.size(), accepted) == 0) {
+            return true;
+        }
     }
+    return false;
+}
+
+HttpClient::TransferStats HttpClient::getTransferStats() const {
+    TransferStats stats;
+    stats.bytes_received = bytes_received_.load();
+    stats.bytes_decoded = bytes_decoded_.load();
+    stats.early_aborts = early_aborts_.load();
+    stats.bytes_saved = bytes_saved_.load();
+    return stats;
+}
 
-    if (!relativeUrl.empty() && relativeUrl[0] == '/')
-    {
-        size_t domainEnd = baseUrl.find('/', protocolEnd + 3);
+void HttpClient::setReplayArchive(std::unique_ptr<WarcArchive> archive) {
+    replay_archive_ = std::move(archive);
+}
+
+void HttpClient::setCaptureWriter(std::unique_ptr<WarcWriter> writer) {
+    capture_ = std::move(writer);
+}
+
+size_t HttpClient::getCapturedCount() const {
+    return capture_ ? capture_->getRecordCount() : 0;
+}
+
+HttpResponse HttpClient::replay(const std::string& url, const FetchOptions& options) {
+    std::string current_url = url;
+
+    for (int attempt = 1; ; ++attempt) {
+        HttpResponse response;
+        response.final_url = current_url;
+
+        std::string message;
+        if (!replay_archive_->find(current_url, message)) {
+            response.status_code = 404;
+            response.error_message = "Not in replay archive: " + current_url;
+            return response;
+        }
+        bytes_received_ += message.size();
 
-        if (domainEnd != std::string::npos)
-        {
-            return baseUrl.substr(0, domainEnd) + relativeUrl;
+        http::response_parser<http::string_body> parser;
+        parser.eager(true);
+        parser.body_limit(boost::none);
+        beast::error_code ec;
+        parser.put(net::buffer(message), ec);
+        if (!ec && !parser.is_done()) {
+            parser.put_eof(ec);
         }
-        else
-        {
-            return baseUrl + relativeUrl;
+        if (ec) {
+            response.error_message = "Replayed response is malformed: " + ec.message();
+            return response;
         }
-    }
 
-    std::string base = baseUrl;
-    size_t lastSlash = base.rfind('/');
+        const auto& header = parser.get();
+        readResponseHeader(header, response);
 
-    if (lastSlash > protocolEnd + 2)
-    {
-        base = base.substr(0, lastSlash + 1);
-    }
-    else
-    {
-        if (base.back() != '/')
-        {
-            base += '/';
+        if (response.success && !options.any_content_type && !isAcceptedContentType(response.content_type)) {
+            early_aborts_++;
+            bytes_saved_ += parser.get().body().size();
+            response.body_skipped = true;
+            return response;
+        }
+
+        // Archives from other tools keep the body as it was sent
+        std::string content_encoding;
+        auto content_encoding_it = header.find(http::field::content_encoding);
+        if (content_encoding_it != header.end()) {
+            content_encoding = std::string(content_encoding_it->value());
         }
+        ContentDecoder decoder;
+        const std::string& raw_body = parser.get().body();
+        if (!decoder.reset(content_encoding) ||
+            !decoder.write(raw_body.data(), raw_body.size(), response.body) ||
+            !decoder.finish()) {
+            HttpResponse failed;
+            failed.error_message = "HTTP request failed: " + decoder.getError();
+            return failed;
+        }
+        bytes_decoded_ += response.body.size();
+
+        if (max_body_bytes_ > 0 && response.body.size() > max_body_bytes_) {
+            HttpResponse failed;
+            failed.error_message = "Response body too large: " + std::to_string(response.body.size()) + " bytes";
+            return failed;
+        }
+
+        if (response.success || response.not_modified || response.status_code < 300 || response.status_code >= 400) {
+            return response;
+        }
+
+        if (response.redirect_location.empty()) {
+            response.error_message = "Redirect response with no location header.";
+            return response;
+        }
+
+        if (attempt >= MAX_REDIRECTS) {
+            response.error_message = "Too many redirects.";
+            return response;
+        }
+
+        std::string location;
+        if (!resolveUrlReference(current_url, response.redirect_location, location)) {
+            response.error_message = "Invalid redirect location: " + response.redirect_location;
+            return response;
+        }
+        current_url = location;
     }
-    return base + relativeUrl;
 }
 
-template<typename Stream>
-HttpResponse HttpClient::executeRequest(Stream& stream, const UrlParts& url_parts) {
-    HttpResponse response;
-    
-    // Set up an HTTP GET request message
-    http::request<http::string_body> req{http::verb::get, url_parts.path, 11};
-    req.set(http::field::host, url_parts.host);
-    req.set(http::field::user_agent, user_agent_);
-    req.set(http::field::accept, "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
-    req.set(http::field::accept_language, "en-US,en;q=0.5");
-    req.set(http::field::connection, "close");
-    
-    // Send the HTTP request
-    http::write(stream, req);
-    
-    // Declare a container to hold the response
-    beast::flat_buffer buffer;
-    http::response<http::dynamic_body> res;
-    
-    // Receive the HTTP response
-    http::read(stream, buffer, res);
-    
-    // Extract response data
-    response.status_code = static_cast<int>(res.result_int());
-    response.body = beast::buffers_to_string(res.body().data());
-    response.success = (response.status_code >= 200 && response.status_code < 300);
+HttpClient::UrlParts HttpClient::parseUrl(const std::string& url) {
+    UrlParts parts;
+    parts.is_https = false;
     
-    // Extract content type
-    auto content_type_it = res.find(http::field::content_type);
-    if (content_type_it != res.end()) {
-        response.content_type = content_type_it->value();
+    UrlView view;
+    if (!parseUrlReference(url, view) || !view.has_authority || view.host.empty()) {
+        return parts;
     }
     
-    // Handle redirects (simple implementation)
-    if (response.status_code >= 300 && response.status_code < 400) {
-        auto location_it = res.find(http::field::location);
-        if (location_it != res.end()) {
-            response.redirect_location = location_it->value();
-        }
+    std::string scheme(view.scheme);
+    std::transform(scheme.begin(), scheme.end(), scheme.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (scheme != "http" && scheme != "https") {
+        return parts;
     }
     
-    // Gracefully close the stream
-    beast::error_code ec;
-    if constexpr (std::is_same_v<Stream, ssl::stream<tcp::socket>>) {
-        stream.shutdown(ec);
-    } else {
-        stream.shutdown(tcp::socket::shutdown_both, ec);
+    parts.scheme = scheme;
+    parts.host = std::string(view.host);
+    parts.is_https = (scheme == "https");
+    parts.port = view.port.empty() ? (parts.is_https ? "443" : "80") : std::string(view.port);
+    
+    // Request target: path and query, never the fragment
+    parts.path = view.path.empty() ? "/" : std::string(view.path);
+    if (view.has_query) {
+        parts.path += '?';
+        parts.path += view.query;
     }
-        
-    return response;
-}
\ No newline at end of file
+    
+    return parts;
+}
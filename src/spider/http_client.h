@@ -2,13 +2,25 @@
 
 #include <string>
 #include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/beast/ssl.hpp>
 #include <boost/beast/version.hpp>
 #include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/executor_work_guard.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/asio/ssl/stream.hpp>
+#include "connection_pool.h"
+#include "tls_session_cache.h"
+#include "dns_cache.h"
+#include "content_decoder.h"
+#include "warc.h"
 
 namespace beast = boost::beast;
 namespace http = beast::http;
@@ -17,33 +29,140 @@ namespace ssl = net::ssl;
 using tcp = net::ip::tcp;
 
 struct HttpResponse {
-    int status_code;
+    int status_code = 0;
     std::string body;
     std::string content_type;
-    bool success;
+    bool success = false;
     std::string error_message;
     std::string redirect_location;
+    
+    // URL the response came from, after following any redirects
+    std::string final_url;
+    
+    // Cache validators sent by the server
+    std::string etag;
+    std::string last_modified;
+    
+    // 304 reply to a conditional request
+    bool not_modified = false;
+    
+    // Body was not downloaded because the content type is not accepted
+    bool body_skipped = false;
 };
 
+// HTTP/HTTPS client. All requests run asynchronously on one shared
+// io_context driven by a small pool of I/O threads, so many fetches
+// can be in flight at once without a thread per request.
 class HttpClient {
 public:
-    HttpClient();
+    using ResponseHandler = std::function<void(HttpResponse)>;
+    using RequestHeaders = std::vector<std::pair<std::string, std::string>>;
+
+    explicit HttpClient(int io_threads = 2);
     ~HttpClient();
-    
-    // Fetch URL and return response
+
+    // Fetch URL and return response (blocks the calling thread;
+    // must not be called from an I/O thread)
     HttpResponse get(const std::string& url);
+
+    // Start fetching URL; handler is invoked exactly once on an I/O thread
+    void fetchAsync(const std::string& url, ResponseHandler handler);
     
+    // Same, adding headers to the request (e.g. If-None-Match). The extra
+    // headers are not repeated when following a redirect.
+    void fetchAsync(const std::string& url, const RequestHeaders& headers, ResponseHandler handler);
+
+    struct FetchOptions {
+        RequestHeaders headers;
+        bool any_content_type = false;   // download the body whatever its Content-Type
+    };
+
+    // Same, with per-request options
+    void fetchAsync(const std::string& url, const FetchOptions& options, ResponseHandler handler);
+
     // Set timeout for requests (in seconds)
     void setTimeout(int timeout_seconds);
-    
+
     // Set user agent string
     void setUserAgent(const std::string& user_agent);
-    
+
+    const std::string& getUserAgent() const;
+
+    // Only download bodies of successful responses whose Content-Type
+    // starts with one of these (empty accepts everything); others end
+    // after the header with body_skipped set
+    void setAcceptedContentTypes(const std::vector<std::string>& content_types);
+
+    // Fail responses whose body is larger than max_bytes after decoding
+    // (0 = no limit); a larger Content-Length fails before the body is read
+    void setMaxBodySize(size_t max_bytes);
+
+    // Serve every request from archive instead of the network (redirects
+    // are followed inside the archive; URLs it lacks get a 404)
+    void setReplayArchive(std::unique_ptr<WarcArchive> archive);
+
+    // Record every response received from the network in writer
+    void setCaptureWriter(std::unique_ptr<WarcWriter> writer);
+
+    // Number of responses written by the capture writer
+    size_t getCapturedCount() const;
+
+    // Limit pooled keep-alive connections per origin and overall
+    void setConnectionLimits(size_t max_per_host, size_t max_idle_total, int idle_timeout_seconds);
+
+    // Set DNS cache lifetimes (in seconds) and size
+    void setDnsCacheOptions(int ttl_seconds, int negative_ttl_seconds, size_t max_entries);
+
+    // Resolve the host of url in the background so a later fetch finds it cached
+    void prefetchHost(const std::string& url);
+
+    // Number of requests currently in flight
+    size_t getInFlightCount() const;
+
+    // Keep-alive connection reuse statistics
+    ConnectionPool::Stats getConnectionPoolStats() const;
+
+    // TLS session resumption statistics
+    TlsSessionCache::Stats getTlsSessionStats() const;
+
+    // DNS cache statistics
+    DnsCache::Stats getDnsCacheStats() const;
+
+    struct TransferStats {
+        size_t bytes_received;   // header and body bytes read from the network
+        size_t bytes_decoded;    // body bytes after content decoding
+        size_t early_aborts;     // responses cut off by content type or size
+        size_t bytes_saved;      // announced body bytes not downloaded due to early aborts
+    };
+
+    // Transfer volume and early-abort statistics
+    TransferStats getTransferStats() const;
+
 private:
+    class FetchSession;
+
     int timeout_seconds_;
     std::string user_agent_;
     ssl::context ssl_ctx_;
-    
+    TlsSessionCache tls_session_cache_;
+    net::io_context ioc_;
+    net::executor_work_guard<net::io_context::executor_type> work_guard_;
+    DnsCache dns_cache_;
+    ConnectionPool connection_pool_;
+    std::vector<std::thread> io_threads_;
+    std::atomic<size_t> in_flight_;
+
+    std::vector<std::string> accepted_content_types_;
+    size_t max_body_bytes_;
+
+    std::unique_ptr<WarcArchive> replay_archive_;
+    std::unique_ptr<WarcWriter> capture_;
+
+    std::atomic<size_t> bytes_received_;
+    std::atomic<size_t> bytes_decoded_;
+    std::atomic<size_t> early_aborts_;
+    std::atomic<size_t> bytes_saved_;
+
     struct UrlParts {
         std::string scheme;
         std::string host;
@@ -51,12 +170,10 @@ private:
         std::string path;
         bool is_https;
     };
-    
+
     UrlParts parseUrl(const std::string& url);
-    HttpResponse performHttpRequest(const UrlParts& url_parts);
-    HttpResponse performHttpsRequest(const UrlParts& url_parts);
-    std::string resolveUrl(const std::string& baseUrl, const std::string& relativeUrl);
-    
-    template<typename Stream>
-    HttpResponse executeRequest(Stream& stream, const UrlParts& url_parts);
-};
\ No newline at end of file
+    bool isAcceptedContentType(const std::string& content_type) const;
+
+    // Build the response for url from the replay archive
+    HttpResponse replay(const std::string& url, const FetchOptions& options);
+};
@@ -1,4 +1,6 @@
 #include <iostream>
+#include <atomic>
+#include <cstdlib>
 #include <signal.h>
 #include "../common/config_parser.h"
 #include "spider.h"
@@ -6,12 +8,15 @@
 // Global spider instance for signal handling
 Spider* g_spider = nullptr;
 
+std::atomic<bool> g_stop_signalled(false);
+
 void signalHandler(int signum) {
-    std::cout << "\nReceived signal " << signum << ", stopping spider..." << std::endl;
-    if (g_spider) {
-        g_spider->stopCrawling();
+    // The first signal lets the crawl stop cleanly and save a checkpoint;
+    // a second one exits immediately
+    if (g_stop_signalled.exchange(true) || !g_spider) {
+        std::_Exit(signum);
     }
-    exit(signum);
+    g_spider->requestStop();
 }
 
 int main(int argc, char* argv[]) {
@@ -22,10 +27,16 @@ int main(int argc, char* argv[]) {
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
     
-    // Parse command line arguments
+    // Parse command line arguments: [config_file] [--resume]
     std::string config_file = "config/config.ini";
-    if (argc > 1) {
-        config_file = argv[1];
+    bool resume = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--resume") {
+            resume = true;
+        } else {
+            config_file = arg;
+        }
     }
     
     std::cout << "Using config file: " << config_file << std::endl;
@@ -41,13 +52,13 @@ int main(int argc, char* argv[]) {
     Spider spider;
     g_spider = &spider;
     
-    if (!spider.initialize(config)) {
+    if (!spider.initialize(config, resume)) {
         std::cerr << "Failed to initialize spider" << std::endl;
         return 1;
     }
     
     // Start crawling
-    std::cout << "\nStarting web crawling..." << std::endl;
+    std::cout << (resume ? "\nResuming web crawling..." : "\nStarting web crawling...") << std::endl;
     spider.startCrawling();
     
     std::cout << "Spider finished successfully." << std::endl;
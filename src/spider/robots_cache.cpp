@@ -0,0 +1,218 @@
+#include "robots_cache.h"
+#include "../common/url.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+// Failed robots.txt fetches in a row after which an origin's URLs are
+// dropped as disallowed instead of being retried
+const int MAX_CONSECUTIVE_ERRORS = 4;
+
+}
+
+RobotsCache::RobotsCache(Fetcher fetcher, const std::string& user_agent)
+    : fetcher_(std::move(fetcher))
+    , user_agent_(user_agent.substr(0, user_agent.find_first_of("/ ")))
+    , ttl_(24 * 60 * 60)
+    , error_ttl_(5 * 60)
+    , fetches_(0)
+    , fetch_errors_(0)
+    , blocked_(0) {
+}
+
+void RobotsCache::configure(int ttl_seconds, int error_ttl_seconds) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    ttl_ = std::chrono::seconds(std::max(0, ttl_seconds));
+    error_ttl_ = std::chrono::seconds(std::max(0, error_ttl_seconds));
+}
+
+std::chrono::seconds RobotsCache::getErrorTtl() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return error_ttl_;
+}
+
+void RobotsCache::setCrawlDelayHandler(CrawlDelayHandler handler) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    crawl_delay_handler_ = std::move(handler);
+}
+
+bool RobotsCache::isAllowed(const std::string& url) const {
+    std::string origin;
+    std::string path;
+    if (!splitUrl(url, origin, path)) {
+        return true;
+    }
+
+    std::shared_ptr<const RobotsRules> rules;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = entries_.find(origin);
+        if (it == entries_.end() || !it->second.rules) {
+            return true;
+        }
+        if (it->second.errors > 0 && it->second.errors < MAX_CONSECUTIVE_ERRORS) {
+            // Links of an unreachable origin are kept for check() to defer
+            return true;
+        }
+        rules = it->second.rules;
+    }
+
+    if (rules->isAllowed(path)) {
+        return true;
+    }
+    blocked_++;
+    return false;
+}
+
+void RobotsCache::check(const std::string& url, CheckHandler handler) {
+    std::string origin;
+    std::string path;
+    if (!splitUrl(url, origin, path)) {
+        handler(Verdict::Allowed);
+        return;
+    }
+
+    std::shared_ptr<const RobotsRules> rules;
+    int errors = 0;
+    bool start_fetch = false;
+
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+
+        Entry& entry = entries_[origin];
+        bool expired = entry.expires <= std::chrono::steady_clock::now();
+
+        if (expired && !entry.loading) {
+            entry.loading = true;
+            start_fetch = true;
+            fetches_++;
+        }
+
+        // Stale rules keep answering while they are refreshed
+        if (entry.rules) {
+            rules = entry.rules;
+            errors = entry.errors;
+        } else {
+            entry.waiters.push_back(Waiter{path, std::move(handler)});
+        }
+    }
+
+    if (start_fetch) {
+        fetcher_(origin + "/robots.txt", [this, origin](HttpResponse response) {
+            onFetchComplete(origin, response);
+        });
+    }
+
+    if (rules) {
+        handler(decide(*rules, errors, path));
+    }
+}
+
+RobotsCache::Stats RobotsCache::getStats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    Stats stats;
+    stats.fetches = fetches_;
+    stats.fetch_errors = fetch_errors_;
+    stats.blocked = blocked_.load();
+    stats.entries = entries_.size();
+    return stats;
+}
+
+void RobotsCache::onFetchComplete(const std::string& origin, const HttpResponse& response) {
+    // A missing robots.txt (4xx, or a redirect loop) allows everything. A
+    // server error or network failure disallows everything until the
+    // shorter error TTL runs out and the file is fetched again.
+    std::shared_ptr<const RobotsRules> rules;
+    bool error = false;
+    if (response.success) {
+        rules = RobotsRules::parse(response.body, user_agent_);
+    } else if (response.status_code >= 300 && response.status_code < 500) {
+        rules = std::make_shared<RobotsRules>();
+    } else {
+        rules = RobotsRules::disallowAll();
+        error = true;
+    }
+
+    std::vector<Waiter> waiters;
+    CrawlDelayHandler crawl_delay_handler;
+    int errors = 0;
+
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+
+        Entry& entry = entries_[origin];
+        if (error) {
+            fetch_errors_++;
+            if (entry.rules && entry.errors == 0) {
+                // Keep the last good rules rather than dropping them
+                rules = entry.rules;
+            } else {
+                entry.errors++;
+            }
+        } else {
+            entry.errors = 0;
+        }
+        errors = entry.errors;
+
+        entry.rules = rules;
+        entry.expires = std::chrono::steady_clock::now() + (error ? error_ttl_ : ttl_);
+        entry.loading = false;
+        waiters.swap(entry.waiters);
+        crawl_delay_handler = crawl_delay_handler_;
+    }
+
+    if (crawl_delay_handler && rules->getCrawlDelayMs() > 0) {
+        crawl_delay_handler(origin, rules->getCrawlDelayMs());
+    }
+
+    for (Waiter& waiter : waiters) {
+        waiter.handler(decide(*rules, errors, waiter.path));
+    }
+}
+
+RobotsCache::Verdict RobotsCache::decide(const RobotsRules& rules, int errors, const std::string& path) const {
+    if (errors > 0 && errors < MAX_CONSECUTIVE_ERRORS) {
+        return Verdict::Unavailable;
+    }
+    if (rules.isAllowed(path)) {
+        return Verdict::Allowed;
+    }
+    blocked_++;
+    return Verdict::Disallowed;
+}
+
+bool RobotsCache::splitUrl(const std::string& url, std::string& origin, std::string& path) {
+    UrlView parts;
+    if (!parseUrlReference(url, parts) || !parts.has_authority || parts.host.empty()) {
+        return false;
+    }
+
+    std::string scheme(parts.scheme);
+    std::transform(scheme.begin(), scheme.end(), scheme.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (scheme != "http" && scheme != "https") {
+        return false;
+    }
+
+    std::string host(parts.host);
+    std::transform(host.begin(), host.end(), host.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    // Default ports name the same origin as no port
+    origin = scheme + "://" + host;
+    if (!parts.port.empty() && parts.port != (scheme == "https" ? "443" : "80")) {
+        origin += ":";
+        origin += parts.port;
+    }
+
+    path = parts.path.empty() ? "/" : std::string(parts.path);
+    if (path[0] != '/') {
+        path.insert(0, "/");
+    }
+    if (parts.has_query) {
+        path += "?";
+        path += parts.query;
+    }
+    return true;
+}
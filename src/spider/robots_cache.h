@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "http_client.h"
+#include "robots_rules.h"
+
+// Thread-safe per-origin cache of robots.txt rules. Each origin
+// (scheme://host:port) has its robots.txt fetched once per TTL; URLs of an
+// origin whose rules are still loading wait for that single fetch.
+//
+// isAllowed() is the hot-path check for discovered links: one shared-lock
+// map lookup and a match against the compiled rules. It never fetches and
+// allows URLs whose origin has not been loaded yet; check() is the
+// authoritative answer before a fetch.
+//
+// A robots.txt that cannot be fetched (server error or network failure)
+// disallows the whole origin (RFC 9309). check() reports its URLs as
+// Unavailable so they can be retried once the rules are fetched again; after
+// several failures in a row they are reported as Disallowed instead.
+class RobotsCache {
+public:
+    enum class Verdict { Allowed, Disallowed, Unavailable };
+
+    using CheckHandler = std::function<void(Verdict verdict)>;
+
+    // Fetches one robots.txt URL and invokes the handler exactly once.
+    // Replaceable so the cache can be exercised against a stub.
+    using Fetcher = std::function<void(const std::string& url, HttpClient::ResponseHandler handler)>;
+
+    // Called when an origin's rules set a Crawl-delay (in milliseconds)
+    using CrawlDelayHandler = std::function<void(const std::string& origin, long delay_ms)>;
+
+    // Groups are matched against the product token of user_agent
+    // (e.g. "SearchEngine-Spider" for "SearchEngine-Spider/1.0")
+    RobotsCache(Fetcher fetcher, const std::string& user_agent);
+
+    // Set how long rules are kept (in seconds); origins whose robots.txt
+    // could not be fetched are retried after error_ttl_seconds
+    void configure(int ttl_seconds, int error_ttl_seconds);
+
+    // How long to hold back a URL reported as Unavailable
+    std::chrono::seconds getErrorTtl() const;
+
+    void setCrawlDelayHandler(CrawlDelayHandler handler);
+
+    // Check url against cached rules; unknown and unavailable origins are allowed
+    bool isAllowed(const std::string& url) const;
+
+    // Check url, fetching its origin's robots.txt first if needed. The
+    // handler runs immediately when the rules are cached, otherwise on the
+    // thread that completes the fetch.
+    void check(const std::string& url, CheckHandler handler);
+
+    struct Stats {
+        size_t fetches;
+        size_t fetch_errors;
+        size_t blocked;
+        size_t entries;
+    };
+
+    Stats getStats() const;
+
+private:
+    struct Waiter {
+        std::string path;
+        CheckHandler handler;
+    };
+
+    struct Entry {
+        std::shared_ptr<const RobotsRules> rules;   // null until first loaded
+        std::chrono::steady_clock::time_point expires;
+        bool loading = false;
+        int errors = 0;   // failed fetches in a row; rules disallow all while > 0
+        std::vector<Waiter> waiters;
+    };
+
+    Fetcher fetcher_;
+    std::string user_agent_;
+    CrawlDelayHandler crawl_delay_handler_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::chrono::seconds ttl_;
+    std::chrono::seconds error_ttl_;
+
+    size_t fetches_;
+    size_t fetch_errors_;
+    mutable std::atomic<size_t> blocked_;
+
+    mutable std::shared_mutex mutex_;
+
+    void onFetchComplete(const std::string& origin, const HttpResponse& response);
+
+    // Answer for path under an origin's rules; errors is the origin's
+    // count of failed fetches in a row
+    Verdict decide(const RobotsRules& rules, int errors, const std::string& path) const;
+
+    // Split url into its origin and its path with query; false if not http(s)
+    static bool splitUrl(const std::string& url, std::string& origin, std::string& path);
+};
@@ -0,0 +1,214 @@
+#include "robots_rules.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+// RFC 9309 asks parsers to handle at least this much; anything past it is ignored
+const size_t MAX_ROBOTS_BYTES = 500 * 1024;
+
+// Longest Crawl-delay honored, so one host cannot stall its URLs forever
+const long MAX_CRAWL_DELAY_MS = 60 * 1000;
+
+std::string trim(const std::string& value) {
+    size_t first = value.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return "";
+    }
+    size_t last = value.find_last_not_of(" \t\r");
+    return value.substr(first, last - first + 1);
+}
+
+std::string toLower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return value;
+}
+
+}
+
+RobotsRules::RobotsRules()
+    : crawl_delay_ms_(0) {
+}
+
+std::shared_ptr<const RobotsRules> RobotsRules::parse(const std::string& text, const std::string& user_agent) {
+    std::string agent = toLower(user_agent);
+
+    RobotsRules specific;
+    RobotsRules fallback;
+    bool found_specific = false;
+    bool found_fallback = false;
+
+    // Consecutive user-agent lines share the rules that follow them
+    bool reading_agents = false;
+    bool group_specific = false;
+    bool group_fallback = false;
+
+    size_t end = std::min(text.size(), MAX_ROBOTS_BYTES);
+    size_t line_start = 0;
+    while (line_start < end) {
+        size_t line_end = text.find('\n', line_start);
+        if (line_end == std::string::npos || line_end > end) {
+            line_end = end;
+        }
+        std::string line = text.substr(line_start, line_end - line_start);
+        line_start = line_end + 1;
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string key = toLower(trim(line.substr(0, colon)));
+        std::string value = trim(line.substr(colon + 1));
+
+        if (key == "user-agent") {
+            if (!reading_agents) {
+                group_specific = false;
+                group_fallback = false;
+                reading_agents = true;
+            }
+            std::string name = toLower(value);
+            if (name == "*") {
+                group_fallback = true;
+                found_fallback = true;
+            } else if (!name.empty() && name == agent) {
+                group_specific = true;
+                found_specific = true;
+            }
+            continue;
+        }
+
+        if (key != "allow" && key != "disallow" && key != "crawl-delay") {
+            // Sitemap and unknown keys do not end a group
+            continue;
+        }
+        reading_agents = false;
+
+        if (key == "crawl-delay") {
+            long delay_ms = 0;
+            try {
+                delay_ms = static_cast<long>(std::stod(value) * 1000);
+            } catch (const std::exception&) {
+                continue;
+            }
+            delay_ms = std::max(0L, std::min(delay_ms, MAX_CRAWL_DELAY_MS));
+            if (group_specific) {
+                specific.crawl_delay_ms_ = delay_ms;
+            }
+            if (group_fallback) {
+                fallback.crawl_delay_ms_ = delay_ms;
+            }
+            continue;
+        }
+
+        // An empty Disallow allows everything, which is the default anyway
+        if (value.empty()) {
+            continue;
+        }
+
+        bool allow = (key == "allow");
+        if (group_specific) {
+            specific.addRule(allow, value);
+        }
+        if (group_fallback) {
+            fallback.addRule(allow, value);
+        }
+    }
+
+    auto rules = std::make_shared<RobotsRules>();
+    if (found_specific) {
+        *rules = std::move(specific);
+    } else if (found_fallback) {
+        *rules = std::move(fallback);
+    }
+    rules->compile();
+    return rules;
+}
+
+std::shared_ptr<const RobotsRules> RobotsRules::disallowAll() {
+    auto rules = std::make_shared<RobotsRules>();
+    rules->addRule(false, "/");
+    rules->compile();
+    return rules;
+}
+
+bool RobotsRules::isAllowed(const std::string& path) const {
+    if (rules_.empty() || path == "/robots.txt") {
+        return true;
+    }
+
+    for (const Rule& rule : rules_) {
+        if (matches(rule, path)) {
+            return rule.allow;
+        }
+    }
+    return true;
+}
+
+void RobotsRules::addRule(bool allow, const std::string& pattern) {
+    Rule rule;
+    rule.allow = allow;
+    rule.pattern = pattern;
+    rule.anchored = (pattern.back() == '$');
+
+    std::string body = rule.anchored ? pattern.substr(0, pattern.size() - 1) : pattern;
+    size_t part_start = 0;
+    while (true) {
+        size_t star = body.find('*', part_start);
+        if (star == std::string::npos) {
+            rule.parts.push_back(body.substr(part_start));
+            break;
+        }
+        rule.parts.push_back(body.substr(part_start, star - part_start));
+        part_start = star + 1;
+    }
+    rule.wildcard = (rule.parts.size() > 1);
+
+    rules_.push_back(std::move(rule));
+}
+
+void RobotsRules::compile() {
+    std::stable_sort(rules_.begin(), rules_.end(), [](const Rule& a, const Rule& b) {
+        if (a.pattern.size() != b.pattern.size()) {
+            return a.pattern.size() > b.pattern.size();
+        }
+        return a.allow && !b.allow;
+    });
+}
+
+bool RobotsRules::matches(const Rule& rule, const std::string& path) {
+    const std::string& first = rule.parts.front();
+
+    if (!rule.wildcard) {
+        if (rule.anchored) {
+            return path == first;
+        }
+        return path.compare(0, first.size(), first) == 0;
+    }
+
+    if (path.compare(0, first.size(), first) != 0) {
+        return false;
+    }
+    size_t position = first.size();
+
+    // Each '*' matches the shortest run that lets the next part follow
+    for (size_t i = 1; i + 1 < rule.parts.size(); ++i) {
+        size_t found = path.find(rule.parts[i], position);
+        if (found == std::string::npos) {
+            return false;
+        }
+        position = found + rule.parts[i].size();
+    }
+
+    const std::string& last = rule.parts.back();
+    if (rule.anchored) {
+        return path.size() >= position + last.size() &&
+               path.compare(path.size() - last.size(), last.size(), last) == 0;
+    }
+    return path.find(last, position) != std::string::npos;
+}
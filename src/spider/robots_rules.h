@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+// Rules from one robots.txt (RFC 9309) that apply to a single user agent,
+// compiled for matching. Rules are kept longest first, so the first rule
+// that matches a path is the one that decides; patterns without wildcards
+// are plain prefix compares.
+class RobotsRules {
+public:
+    // Rules that allow everything (no robots.txt, or one with no group for us)
+    RobotsRules();
+
+    // Parse robots.txt text and keep the group for user_agent (its product
+    // token, e.g. "SearchEngine-Spider"), falling back to the "*" group
+    static std::shared_ptr<const RobotsRules> parse(const std::string& text, const std::string& user_agent);
+
+    // Rules that disallow every path
+    static std::shared_ptr<const RobotsRules> disallowAll();
+
+    // Check a URL path with its query (e.g. "/search?q=x"); "/robots.txt"
+    // is always allowed
+    bool isAllowed(const std::string& path) const;
+
+    // Crawl-delay of the matching group in milliseconds (0 if none)
+    long getCrawlDelayMs() const { return crawl_delay_ms_; }
+
+    size_t getRuleCount() const { return rules_.size(); }
+
+private:
+    struct Rule {
+        bool allow;
+        std::string pattern;               // as written, used for ordering
+        std::vector<std::string> parts;    // pattern split at '*'
+        bool anchored;                     // pattern ended with '$'
+        bool wildcard;                     // more than one part
+    };
+
+    std::vector<Rule> rules_;
+    long crawl_delay_ms_;
+
+    void addRule(bool allow, const std::string& pattern);
+
+    // Sort rules so the longest (and, on a tie, the allowing) one comes first
+    void compile();
+
+    static bool matches(const Rule& rule, const std::string& path);
+};
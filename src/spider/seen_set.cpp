@@ -0,0 +1,255 @@
+#include "seen_set.h"
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+uint64_t mix64(uint64_t x) {
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+const size_t INITIAL_SLOTS = 1024;
+
+}
+
+uint64_t urlFingerprint(const std::string& url) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : url) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return mix64(hash);
+}
+
+std::unique_ptr<SeenSet> createSeenSet(const SeenSetOptions& options, size_t shard_count) {
+    size_t per_shard = std::max<size_t>(1, options.expected_urls / std::max<size_t>(1, shard_count));
+
+    if (options.mode == "fingerprint") {
+        return std::make_unique<FingerprintSeenSet>(options.bloom_front, per_shard, options.false_positive_rate);
+    }
+    if (options.mode == "bloom") {
+        return std::make_unique<BloomSeenSet>(per_shard, options.false_positive_rate);
+    }
+    return std::make_unique<ExactSeenSet>();
+}
+
+// ExactSeenSet
+
+bool ExactSeenSet::insert(const std::string& url) {
+    if (urls_.emplace(url, false).second) {
+        string_bytes_ += url.size() > 15 ? url.size() + 1 : 0;
+        return true;
+    }
+    return false;
+}
+
+bool ExactSeenSet::isProcessed(const std::string& url) const {
+    auto it = urls_.find(url);
+    return it != urls_.end() && it->second;
+}
+
+bool ExactSeenSet::markProcessed(const std::string& url) {
+    auto result = urls_.emplace(url, true);
+    if (result.second) {
+        string_bytes_ += url.size() > 15 ? url.size() + 1 : 0;
+        return true;
+    }
+    if (!result.first->second) {
+        result.first->second = true;
+        return true;
+    }
+    return false;
+}
+
+size_t ExactSeenSet::size() const {
+    return urls_.size();
+}
+
+size_t ExactSeenSet::memoryUsage() const {
+    // Bucket array plus one node per URL (next pointer, std::string,
+    // flag and cached hash) and the out-of-line string buffers
+    const size_t node_bytes = sizeof(void*) + sizeof(std::string) + sizeof(size_t) + sizeof(size_t);
+    return urls_.bucket_count() * sizeof(void*) + urls_.size() * node_bytes + string_bytes_;
+}
+
+// BloomFilter
+
+BloomFilter::BloomFilter(size_t expected_items, double false_positive_rate) {
+    double p = std::min(0.5, std::max(1e-9, false_positive_rate));
+    double n = static_cast<double>(std::max<size_t>(1, expected_items));
+    double ln2 = std::log(2.0);
+
+    double m = std::ceil(-n * std::log(p) / (ln2 * ln2));
+    bit_count_ = std::max<uint64_t>(64, static_cast<uint64_t>(m));
+    hash_count_ = std::max(1, static_cast<int>(std::round(m / n * ln2)));
+    bits_.assign((bit_count_ + 63) / 64, 0);
+}
+
+void BloomFilter::add(uint64_t fingerprint) {
+    // Double hashing: bit i = h1 + i * h2
+    uint64_t h1 = fingerprint;
+    uint64_t h2 = mix64(fingerprint) | 1;
+    for (int i = 0; i < hash_count_; ++i) {
+        uint64_t bit = (h1 + static_cast<uint64_t>(i) * h2) % bit_count_;
+        bits_[bit >> 6] |= (1ULL << (bit & 63));
+    }
+}
+
+bool BloomFilter::mayContain(uint64_t fingerprint) const {
+    uint64_t h1 = fingerprint;
+    uint64_t h2 = mix64(fingerprint) | 1;
+    for (int i = 0; i < hash_count_; ++i) {
+        uint64_t bit = (h1 + static_cast<uint64_t>(i) * h2) % bit_count_;
+        if (!(bits_[bit >> 6] & (1ULL << (bit & 63)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t BloomFilter::memoryUsage() const {
+    return bits_.size() * sizeof(uint64_t);
+}
+
+// FingerprintSeenSet
+
+FingerprintSeenSet::FingerprintSeenSet(bool bloom_front, size_t expected_urls, double false_positive_rate)
+    : slots_(INITIAL_SLOTS, 0)
+    , count_(0) {
+    if (bloom_front) {
+        bloom_ = std::make_unique<BloomFilter>(expected_urls, false_positive_rate);
+    }
+}
+
+uint64_t FingerprintSeenSet::key(const std::string& url) {
+    uint64_t fingerprint = urlFingerprint(url) & ~1ULL;
+    return fingerprint != 0 ? fingerprint : 2;
+}
+
+size_t FingerprintSeenSet::find(uint64_t key) const {
+    // Linear probing; returns the slot holding key or the empty slot where it belongs
+    size_t mask = slots_.size() - 1;
+    size_t index = static_cast<size_t>(key >> 1) & mask;
+    while (slots_[index] != 0 && (slots_[index] & ~1ULL) != key) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+bool FingerprintSeenSet::insert(const std::string& url) {
+    uint64_t k = key(url);
+
+    if (bloom_ && !bloom_->mayContain(k)) {
+        bloom_->add(k);
+    } else if (slots_[find(k)] != 0) {
+        return false;
+    }
+
+    if ((count_ + 1) * 10 > slots_.size() * 7) {
+        grow();
+    }
+
+    slots_[find(k)] = k;
+    count_++;
+    return true;
+}
+
+bool FingerprintSeenSet::isProcessed(const std::string& url) const {
+    uint64_t k = key(url);
+    if (bloom_ && !bloom_->mayContain(k)) {
+        return false;
+    }
+    return (slots_[find(k)] & 1ULL) != 0;
+}
+
+bool FingerprintSeenSet::markProcessed(const std::string& url) {
+    uint64_t k = key(url);
+    size_t index = find(k);
+
+    if (slots_[index] == 0) {
+        if (bloom_) {
+            bloom_->add(k);
+        }
+        if ((count_ + 1) * 10 > slots_.size() * 7) {
+            grow();
+            index = find(k);
+        }
+        slots_[index] = k | 1ULL;
+        count_++;
+        return true;
+    }
+
+    if (slots_[index] & 1ULL) {
+        return false;
+    }
+    slots_[index] |= 1ULL;
+    return true;
+}
+
+size_t FingerprintSeenSet::size() const {
+    return count_;
+}
+
+size_t FingerprintSeenSet::memoryUsage() const {
+    return slots_.size() * sizeof(uint64_t) + (bloom_ ? bloom_->memoryUsage() : 0);
+}
+
+void FingerprintSeenSet::grow() {
+    std::vector<uint64_t> old_slots(slots_.size() * 2, 0);
+    old_slots.swap(slots_);
+
+    for (uint64_t slot : old_slots) {
+        if (slot != 0) {
+            slots_[find(slot & ~1ULL)] = slot;
+        }
+    }
+}
+
+// BloomSeenSet
+
+BloomSeenSet::BloomSeenSet(size_t expected_urls, double false_positive_rate)
+    : queued_(expected_urls, false_positive_rate)
+    , processed_(expected_urls, false_positive_rate)
+    , count_(0) {
+}
+
+bool BloomSeenSet::insert(const std::string& url) {
+    uint64_t fingerprint = urlFingerprint(url);
+    if (queued_.mayContain(fingerprint)) {
+        return false;
+    }
+    queued_.add(fingerprint);
+    count_++;
+    return true;
+}
+
+bool BloomSeenSet::isProcessed(const std::string& url) const {
+    return processed_.mayContain(urlFingerprint(url));
+}
+
+bool BloomSeenSet::markProcessed(const std::string& url) {
+    uint64_t fingerprint = urlFingerprint(url);
+    if (processed_.mayContain(fingerprint)) {
+        return false;
+    }
+    if (!queued_.mayContain(fingerprint)) {
+        queued_.add(fingerprint);
+        count_++;
+    }
+    processed_.add(fingerprint);
+    return true;
+}
+
+size_t BloomSeenSet::size() const {
+    return count_;
+}
+
+size_t BloomSeenSet::memoryUsage() const {
+    return queued_.memoryUsage() + processed_.memoryUsage();
+}
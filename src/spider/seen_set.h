@@ -0,0 +1,121 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <unordered_map>
+
+// Set of URLs the spider has queued, each with a processed flag.
+// Implementations are not thread-safe; UrlQueue guards each shard.
+class SeenSet {
+public:
+    virtual ~SeenSet() = default;
+
+    // Record url as queued; returns false if it was already known
+    virtual bool insert(const std::string& url) = 0;
+
+    // Check if url has been marked processed
+    virtual bool isProcessed(const std::string& url) const = 0;
+
+    // Mark url processed (adding it if unknown); returns true if it was not processed before
+    virtual bool markProcessed(const std::string& url) = 0;
+
+    // Number of URLs recorded
+    virtual size_t size() const = 0;
+
+    // Approximate heap bytes used
+    virtual size_t memoryUsage() const = 0;
+};
+
+struct SeenSetOptions {
+    // exact, fingerprint or bloom
+    std::string mode = "exact";
+
+    // Expected number of URLs (sizes the Bloom filter)
+    size_t expected_urls = 10000000;
+
+    // Target false-positive rate of the Bloom filter
+    double false_positive_rate = 0.001;
+
+    // Put a Bloom filter in front of the fingerprint table
+    bool bloom_front = false;
+};
+
+// Create a seen-set for one of shard_count shards
+std::unique_ptr<SeenSet> createSeenSet(const SeenSetOptions& options, size_t shard_count);
+
+// 64-bit URL fingerprint (FNV-1a with a final avalanche step)
+uint64_t urlFingerprint(const std::string& url);
+
+// Exact set of full URL strings (the original behaviour)
+class ExactSeenSet : public SeenSet {
+public:
+    bool insert(const std::string& url) override;
+    bool isProcessed(const std::string& url) const override;
+    bool markProcessed(const std::string& url) override;
+    size_t size() const override;
+    size_t memoryUsage() const override;
+
+private:
+    std::unordered_map<std::string, bool> urls_;
+    size_t string_bytes_ = 0;
+};
+
+// Bloom filter over 64-bit fingerprints
+class BloomFilter {
+public:
+    BloomFilter(size_t expected_items, double false_positive_rate);
+
+    void add(uint64_t fingerprint);
+    bool mayContain(uint64_t fingerprint) const;
+    size_t memoryUsage() const;
+
+private:
+    std::vector<uint64_t> bits_;
+    uint64_t bit_count_;
+    int hash_count_;
+};
+
+// Open-addressing table of 64-bit fingerprints; about 12-16 bytes per URL.
+// Two distinct URLs collide with probability ~n/2^63, so a URL may be
+// skipped as already seen with that (negligible) probability.
+class FingerprintSeenSet : public SeenSet {
+public:
+    FingerprintSeenSet(bool bloom_front, size_t expected_urls, double false_positive_rate);
+
+    bool insert(const std::string& url) override;
+    bool isProcessed(const std::string& url) const override;
+    bool markProcessed(const std::string& url) override;
+    size_t size() const override;
+    size_t memoryUsage() const override;
+
+private:
+    // Slot layout: fingerprint with the lowest bit used as the processed flag; 0 = empty
+    std::vector<uint64_t> slots_;
+    size_t count_;
+    std::unique_ptr<BloomFilter> bloom_;
+
+    static uint64_t key(const std::string& url);
+    size_t find(uint64_t key) const;
+    void grow();
+};
+
+// Two Bloom filters (queued, processed): about 1-2 bytes per URL at a
+// configurable false-positive rate. A false positive means a new URL is
+// taken as already queued and is never crawled.
+class BloomSeenSet : public SeenSet {
+public:
+    BloomSeenSet(size_t expected_urls, double false_positive_rate);
+
+    bool insert(const std::string& url) override;
+    bool isProcessed(const std::string& url) const override;
+    bool markProcessed(const std::string& url) override;
+    size_t size() const override;
+    size_t memoryUsage() const override;
+
+private:
+    BloomFilter queued_;
+    BloomFilter processed_;
+    size_t count_;
+};
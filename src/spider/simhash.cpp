@@ -0,0 +1,209 @@
+#include "simhash.h"
+#include <algorithm>
+#include <mutex>
+#include <cctype>
+
+namespace {
+
+const size_t SHINGLE_WORDS = 3;
+
+uint64_t fnv1a(const std::string& value) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : value) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Spread the bits of a combined hash (splitmix64 finalizer)
+uint64_t mix(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+bool isWordByte(unsigned char c) {
+    // Bytes of multi-byte UTF-8 characters count as letters
+    return std::isalnum(c) || c >= 0x80;
+}
+
+}
+
+uint64_t computeSimHash(const std::string& text, size_t* word_count) {
+    std::vector<uint64_t> word_hashes;
+    std::string word;
+
+    for (size_t i = 0; i <= text.size(); ++i) {
+        unsigned char c = i < text.size() ? static_cast<unsigned char>(text[i]) : ' ';
+        if (isWordByte(c)) {
+            word += static_cast<char>(c < 0x80 ? std::tolower(c) : c);
+        } else if (!word.empty()) {
+            word_hashes.push_back(fnv1a(word));
+            word.clear();
+        }
+    }
+
+    if (word_count) {
+        *word_count = word_hashes.size();
+    }
+    if (word_hashes.empty()) {
+        return 0;
+    }
+
+    int votes[64] = {0};
+    size_t shingle_words = std::min(SHINGLE_WORDS, word_hashes.size());
+    for (size_t start = 0; start + shingle_words <= word_hashes.size(); ++start) {
+        uint64_t hash = 0;
+        for (size_t i = 0; i < shingle_words; ++i) {
+            hash = mix(hash ^ word_hashes[start + i]);
+        }
+        for (int bit = 0; bit < 64; ++bit) {
+            votes[bit] += ((hash >> bit) & 1) ? 1 : -1;
+        }
+    }
+
+    uint64_t fingerprint = 0;
+    for (int bit = 0; bit < 64; ++bit) {
+        if (votes[bit] > 0) {
+            fingerprint |= (1ULL << bit);
+        }
+    }
+    return fingerprint;
+}
+
+int hammingDistance(uint64_t a, uint64_t b) {
+    uint64_t diff = a ^ b;
+    int count = 0;
+    while (diff) {
+        diff &= diff - 1;
+        count++;
+    }
+    return count;
+}
+
+SimHashIndex::SimHashIndex(int max_distance)
+    : max_distance_(std::max(0, std::min(max_distance, 63))) {
+    int blocks = max_distance_ + 1;
+    int shift = 0;
+    for (int i = 0; i < blocks; ++i) {
+        int width = 64 / blocks + (i < 64 % blocks ? 1 : 0);
+        block_shifts_.push_back(shift);
+        block_masks_.push_back(width >= 64 ? ~0ULL : ((1ULL << width) - 1));
+        shift += width;
+    }
+    tables_.resize(blocks);
+}
+
+SimHashIndex::Match SimHashIndex::findOrAdd(const std::string& url, uint64_t fingerprint) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+
+    Match match = findLocked(url, fingerprint);
+    if (match.distance < 0) {
+        addLocked(url, fingerprint);
+    }
+    return match;
+}
+
+void SimHashIndex::add(const std::string& url, uint64_t fingerprint) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    addLocked(url, fingerprint);
+}
+
+void SimHashIndex::remove(const std::string& url, uint64_t fingerprint) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+
+    auto it = entry_by_url_.find(url);
+    if (it == entry_by_url_.end() || entries_[it->second].fingerprint != fingerprint) {
+        return;
+    }
+    uint32_t index = it->second;
+    removeFromTables(index);
+    entry_by_url_.erase(it);
+
+    // Move the last entry into the freed position
+    uint32_t last = static_cast<uint32_t>(entries_.size() - 1);
+    if (index != last) {
+        uint64_t moved = entries_[last].fingerprint;
+        for (size_t block = 0; block < tables_.size(); ++block) {
+            uint64_t key = (moved >> block_shifts_[block]) & block_masks_[block];
+            std::vector<uint32_t>& bucket = tables_[block][key];
+            std::replace(bucket.begin(), bucket.end(), last, index);
+        }
+        entries_[index] = std::move(entries_[last]);
+        entry_by_url_[entries_[index].url] = index;
+    }
+    entries_.pop_back();
+}
+
+size_t SimHashIndex::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return entries_.size();
+}
+
+SimHashIndex::Match SimHashIndex::findLocked(const std::string& url, uint64_t fingerprint) const {
+    Match best;
+
+    for (size_t block = 0; block < tables_.size(); ++block) {
+        uint64_t key = (fingerprint >> block_shifts_[block]) & block_masks_[block];
+        auto it = tables_[block].find(key);
+        if (it == tables_[block].end()) {
+            continue;
+        }
+
+        for (uint32_t index : it->second) {
+            const Entry& entry = entries_[index];
+            int distance = hammingDistance(fingerprint, entry.fingerprint);
+            if (distance > max_distance_ || entry.url == url) {
+                continue;
+            }
+            if (best.distance < 0 || distance < best.distance) {
+                best.url = entry.url;
+                best.distance = distance;
+            }
+        }
+    }
+
+    return best;
+}
+
+void SimHashIndex::addLocked(const std::string& url, uint64_t fingerprint) {
+    uint32_t index;
+    auto it = entry_by_url_.find(url);
+    if (it != entry_by_url_.end()) {
+        index = it->second;
+        if (entries_[index].fingerprint == fingerprint) {
+            return;
+        }
+        removeFromTables(index);
+        entries_[index].fingerprint = fingerprint;
+    } else {
+        index = static_cast<uint32_t>(entries_.size());
+        entries_.push_back(Entry{url, fingerprint});
+        entry_by_url_.emplace(url, index);
+    }
+
+    for (size_t block = 0; block < tables_.size(); ++block) {
+        uint64_t key = (fingerprint >> block_shifts_[block]) & block_masks_[block];
+        tables_[block][key].push_back(index);
+    }
+}
+
+void SimHashIndex::removeFromTables(uint32_t index) {
+    uint64_t fingerprint = entries_[index].fingerprint;
+    for (size_t block = 0; block < tables_.size(); ++block) {
+        uint64_t key = (fingerprint >> block_shifts_[block]) & block_masks_[block];
+        auto it = tables_[block].find(key);
+        if (it == tables_[block].end()) {
+            continue;
+        }
+        std::vector<uint32_t>& bucket = it->second;
+        bucket.erase(std::remove(bucket.begin(), bucket.end(), index), bucket.end());
+        if (bucket.empty()) {
+            tables_[block].erase(it);
+        }
+    }
+}
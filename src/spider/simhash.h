@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include <cstdint>
+
+// 64-bit SimHash of text: every run of three consecutive words votes on
+// each bit, so pages that share most of their text end up a few bits apart.
+// word_count (if given) receives the number of words seen.
+uint64_t computeSimHash(const std::string& text, size_t* word_count = nullptr);
+
+// Number of differing bits
+int hammingDistance(uint64_t a, uint64_t b);
+
+// Thread-safe index of page fingerprints for near-duplicate lookups.
+// Fingerprints are split into max_distance + 1 bit blocks; two fingerprints
+// within max_distance bits agree exactly on at least one block, so only
+// entries sharing a block are compared.
+class SimHashIndex {
+public:
+    explicit SimHashIndex(int max_distance = 3);
+
+    struct Match {
+        std::string url;
+        int distance = -1;   // -1 when nothing was found
+    };
+
+    // Find the closest page other than url within the maximum distance;
+    // if there is none, record url with this fingerprint (replacing its
+    // earlier one) and return an empty match
+    Match findOrAdd(const std::string& url, uint64_t fingerprint);
+
+    // Record url without looking for duplicates (e.g. when loading stored pages)
+    void add(const std::string& url, uint64_t fingerprint);
+
+    // Forget url if it is still recorded with this fingerprint (e.g. when
+    // the page findOrAdd() recorded could not be stored)
+    void remove(const std::string& url, uint64_t fingerprint);
+
+    size_t size() const;
+
+private:
+    struct Entry {
+        std::string url;
+        uint64_t fingerprint;
+    };
+
+    int max_distance_;
+    std::vector<int> block_shifts_;
+    std::vector<uint64_t> block_masks_;
+
+    std::vector<Entry> entries_;
+    std::unordered_map<std::string, uint32_t> entry_by_url_;
+
+    // Per block: block value -> entries with that value
+    std::vector<std::unordered_map<uint64_t, std::vector<uint32_t>>> tables_;
+
+    mutable std::shared_mutex mutex_;
+
+    Match findLocked(const std::string& url, uint64_t fingerprint) const;
+    void addLocked(const std::string& url, uint64_t fingerprint);
+    void removeFromTables(uint32_t index);
+};
@@ -3,22 +3,91 @@
 #include <algorithm>
 #include <chrono>
 #include <thread>
+#include <cstdio>
+#include <sstream>
+#include <functional>
+
+namespace {
+
+// 64-bit FNV-1a of the page body as hex, for spotting unchanged pages
+std::string contentHash(const std::string& body) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : body) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return hex;
+}
+
+size_t elapsedMicroseconds(std::chrono::steady_clock::time_point start) {
+    return static_cast<size_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+// Pages with fewer words are never treated as near-duplicates
+const size_t MIN_SIMHASH_WORDS = 20;
+
+// Split a comma-separated config value into trimmed, non-empty items
+std::vector<std::string> splitList(const std::string& value) {
+    std::vector<std::string> items;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        size_t first = item.find_first_not_of(" \t");
+        if (first == std::string::npos) {
+            continue;
+        }
+        size_t last = item.find_last_not_of(" \t");
+        items.push_back(item.substr(first, last - first + 1));
+    }
+    return items;
+}
+
+}
 
 Spider::Spider() 
     : running_(false)
+    , stop_requested_(false)
     , pages_crawled_(0)
     , pages_indexed_(0)
+    , pages_unchanged_(0)
+    , pages_duplicate_(0)
     , total_words_indexed_(0)
+    , outstanding_urls_(0)
+    , in_flight_(0)
+    , peak_in_flight_(0)
+    , fetch_throttled_(0)
+    , fetch_time_us_(0)
+    , parse_time_us_(0)
+    , store_time_us_(0)
     , max_depth_(2)
-    , num_threads_(4) {
+    , num_lookup_threads_(2)
+    , num_parse_threads_(4)
+    , num_store_threads_(2)
+    , parse_queue_size_(256)
+    , store_queue_size_(256)
+    , io_threads_(2)
+    , max_in_flight_(128)
+    , crawl_delay_ms_(100)
+    , max_connections_per_host_(4)
+    , checkpoint_interval_(30)
+    , resume_(false)
+    , conditional_recrawl_(true) {
 }
 
 Spider::~Spider() {
     stopCrawling();
+    
+    // Shut down I/O threads before the members their handlers touch
+    http_client_.reset();
 }
 
-bool Spider::initialize(const ConfigParser& config) {
+bool Spider::initialize(const ConfigParser& config, bool resume) {
     config_ = config;
+    resume_ = resume;
     
     // Initialize database
     database_ = std::make_unique<Database>();
@@ -32,15 +101,183 @@ bool Spider::initialize(const ConfigParser& config) {
         return false;
     }
     
+    // Pipeline stages: fetch (I/O threads), parse and index (CPU), store (DB)
+    int hardware_threads = static_cast<int>(std::thread::hardware_concurrency());
+    num_parse_threads_ = std::max(1, config_.getIntValue("parse_threads",
+                                                         hardware_threads > 0 ? hardware_threads : num_parse_threads_));
+    num_store_threads_ = std::max(1, config_.getIntValue("store_threads", num_store_threads_));
+    parse_queue_size_ = static_cast<size_t>(std::max(1, config_.getIntValue("parse_queue_size", 256)));
+    store_queue_size_ = static_cast<size_t>(std::max(1, config_.getIntValue("store_queue_size", 256)));
+    fetched_pages_.setCapacity(parse_queue_size_);
+    parsed_pages_.setCapacity(store_queue_size_);
+    
+    // Each store thread writes over its own connection
+    store_databases_.clear();
+    for (int i = 0; i < num_store_threads_; ++i) {
+        auto database = std::make_unique<Database>();
+        if (!database->connect(config_)) {
+            std::cerr << "Failed to open database connection for store thread " << i << std::endl;
+            return false;
+        }
+        store_databases_.push_back(std::move(database));
+    }
+    
     // Initialize other components
     html_parser_ = std::make_unique<HtmlParser>();
     text_indexer_ = std::make_unique<TextIndexer>();
-    http_client_ = std::make_unique<HttpClient>();
     url_queue_ = std::make_unique<UrlQueue>();
     
     // Get configuration values
     start_url_ = config_.getStartUrl();
     max_depth_ = config_.getCrawlDepth();
+    io_threads_ = std::max(1, config_.getIntValue("io_threads", io_threads_));
+    max_in_flight_ = std::max(1, config_.getIntValue("fetch_concurrency", max_in_flight_));
+    int min_in_flight = std::max(1, config_.getIntValue("fetch_concurrency_min", std::min(8, max_in_flight_)));
+    concurrency_.configure(static_cast<size_t>(min_in_flight), static_cast<size_t>(max_in_flight_),
+                           config_.getValue("adaptive_concurrency") != "false");
+    try {
+        std::string max_error_rate = config_.getValue("concurrency_max_error_rate");
+        std::string latency_tolerance = config_.getValue("concurrency_latency_tolerance");
+        concurrency_.setThresholds(max_error_rate.empty() ? 0.1 : std::stod(max_error_rate),
+                                   latency_tolerance.empty() ? 2.0 : std::stod(latency_tolerance));
+    } catch (const std::exception&) {
+        // Keep the default thresholds
+    }
+    
+    crawl_delay_ms_ = std::max(0, config_.getIntValue("crawl_delay_ms", crawl_delay_ms_));
+    max_connections_per_host_ = std::max(1, config_.getIntValue("max_connections_per_host", max_connections_per_host_));
+    url_queue_->setPoliteness(std::chrono::milliseconds(crawl_delay_ms_), max_connections_per_host_);
+    
+    SeenSetOptions seen_set_options;
+    std::string seen_set_mode = config_.getValue("seen_set");
+    if (!seen_set_mode.empty()) {
+        seen_set_options.mode = seen_set_mode;
+    }
+    seen_set_options.expected_urls = static_cast<size_t>(
+        std::max(1, config_.getIntValue("seen_set_expected_urls", 10000000)));
+    try {
+        seen_set_options.false_positive_rate = std::stod(config_.getValue("seen_set_false_positive_rate"));
+    } catch (const std::exception&) {
+        // Keep the default rate
+    }
+    seen_set_options.bloom_front = config_.getValue("seen_set_bloom_front") == "true";
+    url_queue_->setSeenSetOptions(seen_set_options);
+    
+    int frontier_memory_items = config_.getIntValue("frontier_memory_items", 100000);
+    if (frontier_memory_items > 0) {
+        std::string spill_dir = config_.getValue("frontier_spill_dir");
+        url_queue_->enableSpill(spill_dir.empty() ? "frontier_spill" : spill_dir,
+                                static_cast<size_t>(frontier_memory_items));
+    }
+    
+    conditional_recrawl_ = config_.getValue("conditional_recrawl") != "false";
+    
+    // Stored validators are looked up over connections of their own, so
+    // the dispatcher never waits on the database
+    lookup_databases_.clear();
+    if (conditional_recrawl_) {
+        num_lookup_threads_ = std::max(1, config_.getIntValue("lookup_threads", num_lookup_threads_));
+        for (int i = 0; i < num_lookup_threads_; ++i) {
+            auto database = std::make_unique<Database>();
+            if (!database->connect(config_)) {
+                std::cerr << "Failed to open database connection for lookup thread " << i << std::endl;
+                return false;
+            }
+            lookup_databases_.push_back(std::move(database));
+        }
+    }
+    
+    if (config_.getValue("near_duplicate_detection") != "false") {
+        simhash_index_ = std::make_unique<SimHashIndex>(config_.getIntValue("near_duplicate_distance", 3));
+        for (const auto& fingerprint : database_->getDocumentFingerprints()) {
+            simhash_index_->add(fingerprint.first, static_cast<uint64_t>(fingerprint.second));
+        }
+    }
+    
+    checkpoint_interval_ = std::max(0, config_.getIntValue("checkpoint_interval", checkpoint_interval_));
+    if (checkpoint_interval_ > 0) {
+        std::string checkpoint_file = config_.getValue("checkpoint_file");
+        journal_ = std::make_unique<CrawlJournal>(checkpoint_file.empty() ? "crawl.checkpoint" : checkpoint_file);
+    } else if (resume_) {
+        std::cerr << "Cannot resume: checkpoints are disabled (checkpoint_interval=0)" << std::endl;
+        return false;
+    }
+    
+    http_client_ = std::make_unique<HttpClient>(io_threads_);
+    http_client_->setConnectionLimits(
+        static_cast<size_t>(max_connections_per_host_),
+        static_cast<size_t>(std::max(0, config_.getIntValue("http_max_idle_connections", 256))),
+        config_.getIntValue("http_idle_timeout", 30));
+    http_client_->setDnsCacheOptions(
+        config_.getIntValue("dns_ttl", 300),
+        config_.getIntValue("dns_negative_ttl", 30),
+        static_cast<size_t>(std::max(1, config_.getIntValue("dns_cache_size", 10000))));
+    
+    // Offline crawls: serve fetches from a WARC, or record live fetches into one
+    std::string replay_warc = config_.getValue("replay_warc");
+    std::string capture_warc = config_.getValue("capture_warc");
+    if (!replay_warc.empty()) {
+        auto archive = std::make_unique<WarcArchive>(replay_warc);
+        if (!archive->open()) {
+            std::cerr << "Failed to open replay archive: " << archive->getError() << std::endl;
+            return false;
+        }
+        std::cout << "Replaying " << archive->size() << " responses from " << replay_warc << std::endl;
+        http_client_->setReplayArchive(std::move(archive));
+    } else if (!capture_warc.empty()) {
+        auto writer = std::make_unique<WarcWriter>(capture_warc);
+        if (!writer->open()) {
+            std::cerr << "Failed to create capture file: " << capture_warc << std::endl;
+            return false;
+        }
+        std::cout << "Capturing responses to " << capture_warc << std::endl;
+        http_client_->setCaptureWriter(std::move(writer));
+    }
+    
+    if (config_.getValue("respect_robots") != "false") {
+        HttpClient* http_client = http_client_.get();
+        robots_cache_ = std::make_unique<RobotsCache>(
+            [http_client](const std::string& url, HttpClient::ResponseHandler handler) {
+                HttpClient::FetchOptions options;
+                options.any_content_type = true;
+                http_client->fetchAsync(url, options, std::move(handler));
+            },
+            http_client_->getUserAgent());
+        robots_cache_->configure(
+            config_.getIntValue("robots_ttl", 86400),
+            config_.getIntValue("robots_error_ttl", 300));
+        
+        UrlQueue* url_queue = url_queue_.get();
+        robots_cache_->setCrawlDelayHandler([url_queue](const std::string& origin, long delay_ms) {
+            url_queue->setHostCrawlDelay(origin, std::chrono::milliseconds(delay_ms));
+        });
+    }
+    
+    // Link filter rules are compiled once and shared by all parse threads
+    UrlFilter::Rules filter_rules;
+    filter_rules.allow_domains = splitList(config_.getValue("url_allow_domains"));
+    filter_rules.deny_domains = splitList(config_.getValue("url_deny_domains"));
+    std::string skip_extensions = config_.getValue("url_skip_extensions");
+    filter_rules.skip_extensions = skip_extensions.empty()
+        ? UrlFilter::Rules::defaultSkipExtensions()
+        : splitList(skip_extensions == "none" ? "" : skip_extensions);
+    filter_rules.allow_path_prefixes = splitList(config_.getValue("url_allow_path_prefixes"));
+    filter_rules.deny_path_prefixes = splitList(config_.getValue("url_deny_path_prefixes"));
+    filter_rules.deny_path_suffixes = splitList(config_.getValue("url_deny_path_suffixes"));
+    filter_rules.deny_regex = config_.getValue("url_deny_regex");
+    filter_rules.max_url_length = static_cast<size_t>(std::max(1, config_.getIntValue("max_url_length", 500)));
+    try {
+        url_filter_ = std::make_unique<UrlFilter>(filter_rules);
+    } catch (const std::regex_error& e) {
+        std::cerr << "Invalid url_deny_regex: " << e.what() << std::endl;
+        return false;
+    }
+    
+    // Non-HTML bodies are never parsed, so do not download them
+    std::string accepted_content_types = config_.getValue("accepted_content_types");
+    http_client_->setAcceptedContentTypes(splitList(accepted_content_types.empty() ? "text/html" : accepted_content_types));
+    http_client_->setMaxBodySize(
+        static_cast<size_t>(std::max(0, config_.getIntValue("max_page_bytes", 10 * 1024 * 1024))));
     
     if (start_url_.empty()) {
         std::cerr << "Start URL not configured" << std::endl;
@@ -50,7 +287,27 @@ bool Spider::initialize(const ConfigParser& config) {
     std::cout << "Spider initialized successfully" << std::endl;
     std::cout << "Start URL: " << start_url_ << std::endl;
     std::cout << "Max depth: " << max_depth_ << std::endl;
-    std::cout << "Worker threads: " << num_threads_ << std::endl;
+    std::cout << "Parse threads: " << num_parse_threads_ << " (queue " << parse_queue_size_
+              << "), store threads: " << num_store_threads_ << " (queue " << store_queue_size_ << ")" << std::endl;
+    std::cout << "I/O threads: " << io_threads_ << std::endl;
+    if (conditional_recrawl_) {
+        std::cout << "Validator lookup threads: " << num_lookup_threads_ << std::endl;
+    }
+    std::cout << "Concurrent fetches: " << concurrency_.getLimit() << " to start, max "
+              << max_in_flight_ << std::endl;
+    std::cout << "Seen-URL set: " << seen_set_options.mode << std::endl;
+    if (simhash_index_) {
+        std::cout << "Near-duplicate detection: " << simhash_index_->size()
+                  << " stored page fingerprints loaded" << std::endl;
+    }
+    std::cout << "URL filter: " << url_filter_->getRuleCount() << " rules" << std::endl;
+    std::cout << "robots.txt: " << (robots_cache_ ? "respected" : "ignored") << std::endl;
+    std::cout << "Per-host crawl delay: " << crawl_delay_ms_ << " ms, max "
+              << max_connections_per_host_ << " connections per host" << std::endl;
+    if (journal_) {
+        std::cout << "Checkpoint: " << journal_->getPath() << " every "
+                  << checkpoint_interval_ << " s" << std::endl;
+    }
     
     return true;
 }
@@ -64,76 +321,298 @@ void Spider::startCrawling() {
     running_ = true;
     pages_crawled_ = 0;
     pages_indexed_ = 0;
+    pages_unchanged_ = 0;
+    pages_duplicate_ = 0;
+    fetch_time_us_ = 0;
+    parse_time_us_ = 0;
+    store_time_us_ = 0;
     total_words_indexed_ = 0;
+    outstanding_urls_ = 0;
+    
+    openCheckpoint();
     
-    // Add start URL to queue
+    // Add start URL to queue (a no-op when resuming)
     url_queue_->enqueue(start_url_, 0);
     
-    // Start worker threads
-    for (int i = 0; i < num_threads_; ++i) {
-        worker_threads_.emplace_back(&Spider::workerThread, this);
+    // Start the stages back to front so every producer has a consumer
+    for (auto& database : store_databases_) {
+        store_threads_.emplace_back(&Spider::storeThread, this, std::ref(*database));
     }
+    for (int i = 0; i < num_parse_threads_; ++i) {
+        parse_threads_.emplace_back(&Spider::parseThread, this);
+    }
+    for (auto& database : lookup_databases_) {
+        lookup_threads_.emplace_back(&Spider::lookupThread, this, std::ref(*database));
+    }
+    
+    dispatcher_thread_ = std::thread(&Spider::dispatcherThread, this);
     
-    std::cout << "Spider started crawling with " << num_threads_ << " threads" << std::endl;
+    std::cout << "Spider started crawling with " << num_parse_threads_ << " parse and "
+              << num_store_threads_ << " store threads, up to "
+              << max_in_flight_ << " concurrent fetches" << std::endl;
     
     // Monitor progress
-    while (running_) {
-        std::this_thread::sleep_for(std::chrono::seconds(5));
+    auto last_progress = std::chrono::steady_clock::now();
+    auto last_checkpoint = last_progress;
+    bool was_idle = false;
+    while (running_ && !stop_requested_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        
+        auto now = std::chrono::steady_clock::now();
+        if (journal_ && now - last_checkpoint >= std::chrono::seconds(checkpoint_interval_)) {
+            writeCheckpoint();
+            last_checkpoint = now;
+        }
+        
+        // Stop once the queue is empty and every stage is idle on two
+        // checks in a row (a URL is briefly in neither while dequeued)
+        bool idle = url_queue_->empty() && outstanding_urls_ == 0;
+        if (idle && was_idle) {
+            std::cout << "Queue is empty, stopping crawling" << std::endl;
+            break;
+        }
+        was_idle = idle;
+        
+        if (now - last_progress < std::chrono::seconds(5)) {
+            continue;
+        }
+        last_progress = now;
         
         auto stats = getStats();
         std::cout << "Progress: " << stats.pages_crawled << " pages crawled, "
                   << stats.pages_indexed << " pages indexed, "
+                  << stats.pages_unchanged << " unchanged, "
+                  << stats.pages_duplicate << " duplicates, "
                   << stats.urls_in_queue << " URLs in queue, "
-                  << stats.total_words_indexed << " total words indexed" << std::endl;
-        
-        // Stop if queue is empty and all threads are idle
-        if (stats.urls_in_queue == 0) {
-            std::this_thread::sleep_for(std::chrono::seconds(2));
-            if (url_queue_->empty()) {
-                std::cout << "Queue is empty, stopping crawling" << std::endl;
-                break;
-            }
-        }
+                  << stats.fetches_in_flight << " fetches in flight (limit "
+                  << stats.fetch_concurrency << "), "
+                  << stats.parse_queue_depth << " pages to parse, "
+                  << stats.store_queue_depth << " pages to store, "
+                  << stats.total_words_indexed << " total words indexed, "
+                  << stats.connections_reused << "/" << stats.connections_acquired
+                  << " connections reused" << std::endl;
+    }
+    
+    if (stop_requested_) {
+        std::cout << "Stop requested, saving checkpoint..." << std::endl;
     }
     
     stopCrawling();
 }
 
+void Spider::requestStop() {
+    stop_requested_ = true;
+}
+
+void Spider::openCheckpoint() {
+    if (!journal_) {
+        return;
+    }
+    
+    CrawlJournal::Snapshot snapshot;
+    bool restored = false;
+    
+    if (resume_) {
+        auto start = std::chrono::steady_clock::now();
+        if (CrawlJournal::load(journal_->getPath(), snapshot)) {
+            restoreSnapshot(snapshot);
+            restored = true;
+            
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            std::cout << "Resumed from " << journal_->getPath() << ": "
+                      << snapshot.processed.size() << " URLs processed, "
+                      << snapshot.pending.size() << " URLs pending (" << elapsed << " ms)" << std::endl;
+        } else {
+            std::cerr << "No usable checkpoint, starting a new crawl" << std::endl;
+        }
+    }
+    
+    // Resuming rewrites the journal compacted; a new crawl starts an empty one
+    if (!journal_->open(restored ? &snapshot : nullptr)) {
+        std::cerr << "Checkpointing disabled" << std::endl;
+        journal_.reset();
+        return;
+    }
+    
+    url_queue_->setJournal(journal_.get());
+}
+
+void Spider::restoreSnapshot(const CrawlJournal::Snapshot& snapshot) {
+    for (const std::string& url : snapshot.processed) {
+        url_queue_->markProcessed(url);
+    }
+    
+    // Pending URLs are in queue order; enqueue each run of equal depth as one batch
+    std::vector<std::string> batch;
+    for (size_t i = 0; i < snapshot.pending.size(); ++i) {
+        batch.push_back(snapshot.pending[i].url);
+        if (i + 1 == snapshot.pending.size() || snapshot.pending[i + 1].depth != snapshot.pending[i].depth) {
+            url_queue_->enqueueMany(batch, snapshot.pending[i].depth);
+            batch.clear();
+        }
+    }
+    
+    pages_crawled_ = snapshot.counters.pages_crawled;
+    pages_indexed_ = snapshot.counters.pages_indexed;
+    total_words_indexed_ = snapshot.counters.total_words_indexed;
+}
+
+void Spider::writeCheckpoint() {
+    if (!journal_) {
+        return;
+    }
+    
+    CrawlJournal::Counters counters;
+    counters.pages_crawled = pages_crawled_.load();
+    counters.pages_indexed = pages_indexed_.load();
+    counters.total_words_indexed = total_words_indexed_.load();
+    journal_->checkpoint(counters);
+}
+
 void Spider::stopCrawling() {
     if (!running_) {
         return;
     }
     
-    running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(in_flight_mutex_);
+        running_ = false;
+    }
+    in_flight_condition_.notify_all();
     url_queue_->stop();
+    lookups_.stop();
+    fetched_pages_.stop();
+    parsed_pages_.stop();
+    
+    if (dispatcher_thread_.joinable()) {
+        dispatcher_thread_.join();
+    }
     
-    // Wait for all worker threads to finish
-    for (auto& thread : worker_threads_) {
+    // Wait for the lookup, parse and store stages to finish
+    for (auto& thread : lookup_threads_) {
         if (thread.joinable()) {
             thread.join();
         }
     }
+    for (auto& thread : parse_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    for (auto& thread : store_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    
+    lookup_threads_.clear();
+    parse_threads_.clear();
+    store_threads_.clear();
     
-    worker_threads_.clear();
+    // Fetches still in flight are not recorded as processed and are
+    // fetched again on resume
+    writeCheckpoint();
     
     auto stats = getStats();
     std::cout << "Crawling stopped. Final stats:" << std::endl;
     std::cout << "  Pages crawled: " << stats.pages_crawled << std::endl;
     std::cout << "  Pages indexed: " << stats.pages_indexed << std::endl;
+    std::cout << "  Pages unchanged since last crawl: " << stats.pages_unchanged << std::endl;
+    std::cout << "  Near-duplicate pages skipped: " << stats.pages_duplicate << std::endl;
     std::cout << "  Total words indexed: " << stats.total_words_indexed << std::endl;
+    
+    double reuse_rate = stats.connections_acquired > 0
+        ? 100.0 * stats.connections_reused / stats.connections_acquired : 0.0;
+    std::cout << "  Connection reuse: " << stats.connections_reused << " of "
+              << stats.connections_acquired << " requests (" << reuse_rate << "%)" << std::endl;
+    std::cout << "  DNS cache: " << stats.dns_cache_hits << " hits, " << stats.dns_cache_misses
+              << " misses" << std::endl;
+    std::cout << "  TLS sessions resumed: " << stats.tls_sessions_resumed << ", full handshakes: "
+              << stats.tls_full_handshakes << std::endl;
+    std::cout << "  Bytes received: " << stats.bytes_received << ", early aborts: "
+              << stats.early_aborts << " (" << stats.bytes_saved << " bytes not downloaded)" << std::endl;
+    if (http_client_->getCapturedCount() > 0) {
+        std::cout << "  Responses captured: " << http_client_->getCapturedCount() << std::endl;
+    }
+    std::cout << "  robots.txt: " << stats.robots_fetches << " fetched, "
+              << stats.robots_blocked << " URLs disallowed" << std::endl;
+    ConcurrencyController::Stats concurrency_stats = concurrency_.getStats();
+    std::cout << "  Fetch concurrency: ended at " << concurrency_stats.limit << ", raised "
+              << concurrency_stats.increases << " times, lowered " << concurrency_stats.decreases
+              << " times (last window " << concurrency_stats.window_latency_ms << " ms, best "
+              << concurrency_stats.best_latency_ms << " ms)" << std::endl;
+    std::cout << "  Parse queue: peak " << stats.parse_queue_peak << " of " << parse_queue_size_
+              << ", fetches held back " << stats.fetch_throttled << " times" << std::endl;
+    std::cout << "  Store queue: peak " << stats.store_queue_peak << " of " << store_queue_size_
+              << ", parse threads held back " << stats.parse_throttled << " times" << std::endl;
 }
 
 Spider::CrawlStats Spider::getStats() const {
     CrawlStats stats;
     stats.pages_crawled = pages_crawled_.load();
     stats.pages_indexed = pages_indexed_.load();
+    stats.pages_unchanged = pages_unchanged_.load();
+    stats.pages_duplicate = pages_duplicate_.load();
     stats.urls_in_queue = url_queue_->getPendingCount();
+    stats.fetch_concurrency = concurrency_.getLimit();
+    stats.fetch_time_us = fetch_time_us_.load();
+    stats.parse_time_us = parse_time_us_.load();
+    stats.store_time_us = store_time_us_.load();
+    
+    BlockingQueue<FetchedPage>::Stats parse_queue_stats = fetched_pages_.getStats();
+    stats.parse_queue_depth = parse_queue_stats.depth;
+    stats.parse_queue_peak = parse_queue_stats.peak;
+    stats.fetch_throttled = fetch_throttled_.load();
+    
+    BlockingQueue<ParsedPage>::Stats store_queue_stats = parsed_pages_.getStats();
+    stats.store_queue_depth = store_queue_stats.depth;
+    stats.store_queue_peak = store_queue_stats.peak;
+    stats.parse_throttled = store_queue_stats.full_waits;
+    
+    stats.fetches_in_flight = 0;
+    stats.connections_acquired = 0;
+    stats.connections_reused = 0;
+    stats.tls_sessions_resumed = 0;
+    stats.tls_full_handshakes = 0;
+    stats.dns_cache_hits = 0;
+    stats.dns_cache_misses = 0;
+    stats.bytes_received = 0;
+    stats.early_aborts = 0;
+    stats.bytes_saved = 0;
+    stats.robots_fetches = 0;
+    stats.robots_blocked = 0;
+    if (robots_cache_) {
+        RobotsCache::Stats robots_stats = robots_cache_->getStats();
+        stats.robots_fetches = robots_stats.fetches;
+        stats.robots_blocked = robots_stats.blocked;
+    }
+    if (http_client_) {
+        stats.fetches_in_flight = http_client_->getInFlightCount();
+        
+        ConnectionPool::Stats pool_stats = http_client_->getConnectionPoolStats();
+        stats.connections_acquired = pool_stats.acquired;
+        stats.connections_reused = pool_stats.reused;
+        
+        TlsSessionCache::Stats tls_stats = http_client_->getTlsSessionStats();
+        stats.tls_sessions_resumed = tls_stats.hits;
+        stats.tls_full_handshakes = tls_stats.misses;
+        
+        DnsCache::Stats dns_stats = http_client_->getDnsCacheStats();
+        stats.dns_cache_hits = dns_stats.hits + dns_stats.negative_hits;
+        stats.dns_cache_misses = dns_stats.misses;
+        
+        HttpClient::TransferStats transfer_stats = http_client_->getTransferStats();
+        stats.bytes_received = transfer_stats.bytes_received;
+        stats.early_aborts = transfer_stats.early_aborts;
+        stats.bytes_saved = transfer_stats.bytes_saved;
+    }
     stats.total_words_indexed = total_words_indexed_.load();
     stats.is_running = running_.load();
     return stats;
 }
 
-void Spider::workerThread() {
+void Spider::dispatcherThread() {
     while (running_) {
         UrlQueueItem item("", 0);
         
@@ -142,18 +621,227 @@ void Spider::workerThread() {
             break;
         }
         
-        if (processUrl(item)) {
-            pages_crawled_++;
+        outstanding_urls_++;
+        
+        if (!prepareUrl(item)) {
+            url_queue_->release(item.url);
+            outstanding_urls_--;
+            continue;
+        }
+        
+        // Wait for a free fetch slot and room in the parse queue
+        {
+            std::unique_lock<std::mutex> lock(in_flight_mutex_);
+            if (fetched_pages_.full()) {
+                fetch_throttled_++;
+            }
+            in_flight_condition_.wait(lock, [this] {
+                return (in_flight_ < concurrency_.getLimit() && !fetched_pages_.full()) || !running_;
+            });
+            
+            if (!running_) {
+                url_queue_->release(item.url);
+                outstanding_urls_--;
+                break;
+            }
+            
+            in_flight_++;
+            peak_in_flight_ = std::max(peak_in_flight_, in_flight_);
+        }
+        
+        // The item holds a fetch slot, so the lookup queue stays within
+        // the fetch limit without blocking here
+        if (conditional_recrawl_) {
+            lookups_.pushNoWait(item);
+        } else {
+            checkRobotsAndFetch(item, DocumentValidators(), HttpClient::RequestHeaders());
+        }
+    }
+}
+
+void Spider::lookupThread(Database& database) {
+    UrlQueueItem item("", 0);
+    
+    while (running_) {
+        if (!lookups_.pop(item)) {
+            // Queue is stopped
+            break;
+        }
+        
+        // Ask for the page only if it changed since it was stored
+        DocumentValidators previous;
+        HttpClient::RequestHeaders headers;
+        if (database.getDocumentValidators(item.url, previous)) {
+            if (!previous.etag.empty()) {
+                headers.emplace_back("If-None-Match", previous.etag);
+            }
+            if (!previous.last_modified.empty()) {
+                headers.emplace_back("If-Modified-Since", previous.last_modified);
+            }
         }
         
-        // Small delay to avoid overwhelming servers
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        checkRobotsAndFetch(item, previous, headers);
     }
 }
 
-bool Spider::processUrl(const UrlQueueItem& item) {
+void Spider::checkRobotsAndFetch(const UrlQueueItem& item, const DocumentValidators& previous,
+                                 const HttpClient::RequestHeaders& headers) {
+    if (!robots_cache_) {
+        startFetch(item, previous, headers);
+        return;
+    }
+    
+    // The first URL of a host waits for its robots.txt
+    robots_cache_->check(item.url, [this, item, previous, headers](RobotsCache::Verdict verdict) {
+        switch (verdict) {
+        case RobotsCache::Verdict::Allowed:
+            startFetch(item, previous, headers);
+            break;
+        case RobotsCache::Verdict::Disallowed:
+            onRobotsBlocked(item);
+            break;
+        case RobotsCache::Verdict::Unavailable:
+            onRobotsUnavailable(item);
+            break;
+        }
+    });
+}
+
+void Spider::startFetch(const UrlQueueItem& item, const DocumentValidators& previous,
+                        const HttpClient::RequestHeaders& headers) {
     std::cout << "Processing URL (depth " << item.depth << "): " << item.url << std::endl;
     
+    auto started = std::chrono::steady_clock::now();
+    http_client_->fetchAsync(item.url, headers, [this, item, previous, started](HttpResponse response) {
+        auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started);
+        onFetchComplete(item, previous, std::move(response), latency);
+    });
+}
+
+void Spider::onRobotsBlocked(const UrlQueueItem& item) {
+    std::cout << "Disallowed by robots.txt: " << item.url << std::endl;
+    
+    {
+        std::lock_guard<std::mutex> lock(in_flight_mutex_);
+        in_flight_--;
+    }
+    in_flight_condition_.notify_one();
+    
+    url_queue_->release(item.url);
+    url_queue_->markProcessed(item.url);
+    outstanding_urls_--;
+}
+
+void Spider::onRobotsUnavailable(const UrlQueueItem& item) {
+    std::cout << "robots.txt unavailable, retrying later: " << item.url << std::endl;
+    
+    {
+        std::lock_guard<std::mutex> lock(in_flight_mutex_);
+        in_flight_--;
+    }
+    in_flight_condition_.notify_one();
+    
+    // Retried once the rules are due to be fetched again
+    url_queue_->retryLater(item, robots_cache_->getErrorTtl());
+    outstanding_urls_--;
+}
+
+void Spider::onFetchComplete(const UrlQueueItem& item, const DocumentValidators& previous,
+                             HttpResponse response, std::chrono::milliseconds latency) {
+    // No status means the request itself failed (connect, timeout, reset)
+    bool overloaded = response.status_code == 0 || response.status_code == 429 ||
+                      response.status_code >= 500;
+    fetch_time_us_ += static_cast<size_t>(latency.count()) * 1000;
+    
+    size_t peak_in_flight;
+    {
+        std::lock_guard<std::mutex> lock(in_flight_mutex_);
+        peak_in_flight = peak_in_flight_;
+        in_flight_--;
+        peak_in_flight_ = in_flight_;
+    }
+    
+    // The limit only grows if the dispatcher actually reached it
+    bool limit_changed = concurrency_.recordFetch(latency, overloaded, peak_in_flight);
+    if (limit_changed) {
+        in_flight_condition_.notify_all();
+    } else {
+        in_flight_condition_.notify_one();
+    }
+    
+    // Free the host's slot so the scheduler can hand out its next URL
+    url_queue_->release(item.url);
+    
+    // Keep parsing and indexing off the I/O threads. The dispatcher keeps
+    // the parse queue near its capacity, so an I/O thread never waits here.
+    fetched_pages_.pushNoWait(FetchedPage{item, previous, std::move(response)});
+}
+
+void Spider::parseThread() {
+    FetchedPage page{UrlQueueItem("", 0), DocumentValidators(), HttpResponse()};
+    
+    while (running_) {
+        if (!fetched_pages_.pop(page)) {
+            // Queue is stopped
+            break;
+        }
+        
+        // Room in the parse queue may let the dispatcher start another fetch
+        {
+            std::lock_guard<std::mutex> lock(in_flight_mutex_);
+        }
+        in_flight_condition_.notify_one();
+        
+        auto started = std::chrono::steady_clock::now();
+        ParsedPage parsed;
+        bool keep = parsePage(page, parsed);
+        parse_time_us_ += elapsedMicroseconds(started);
+        
+        if (!keep) {
+            outstanding_urls_--;
+            continue;
+        }
+        
+        // Blocks while the store stage is behind
+        parsed_pages_.push(std::move(parsed));
+    }
+}
+
+void Spider::storeThread(Database& database) {
+    ParsedPage page;
+    
+    while (running_) {
+        if (!parsed_pages_.pop(page)) {
+            // Queue is stopped
+            break;
+        }
+        
+        auto started = std::chrono::steady_clock::now();
+        
+        if (page.unchanged) {
+            processUnchanged(database, page);
+        } else if (!page.duplicate_of.empty()) {
+            database.storeDuplicate(page.item.url, page.duplicate_of, page.duplicate_distance);
+            pages_duplicate_++;
+            std::cout << "Near-duplicate of " << page.duplicate_of << " (" << page.duplicate_distance
+                      << " bits apart): " << page.item.url << std::endl;
+        } else if (indexPage(database, page)) {
+            pages_indexed_++;
+        } else if (simhash_index_ && page.simhash != 0) {
+            // Pages nearly repeating this one must not be skipped as its copies
+            simhash_index_->remove(page.item.url, page.simhash);
+        }
+        
+        store_time_us_ += elapsedMicroseconds(started);
+        
+        url_queue_->markProcessed(page.item.url);
+        pages_crawled_++;
+        outstanding_urls_--;
+    }
+}
+
+bool Spider::prepareUrl(const UrlQueueItem& item) {
     // Check if already processed
     if (url_queue_->isProcessed(item.url)) {
         return false;
@@ -171,8 +859,23 @@ bool Spider::processUrl(const UrlQueueItem& item) {
         return false;
     }
     
-    // Fetch the page
-    HttpResponse response = http_client_->get(item.url);
+    return true;
+}
+
+bool Spider::parsePage(const FetchedPage& page, ParsedPage& parsed) {
+    const UrlQueueItem& item = page.item;
+    const HttpResponse& response = page.response;
+    
+    parsed.item = item;
+    parsed.previous = page.previous;
+    parsed.validators.etag = response.etag;
+    parsed.validators.last_modified = response.last_modified;
+    parsed.unchanged = false;
+    
+    if (response.not_modified && page.previous.document_id > 0) {
+        parsed.unchanged = true;
+        return true;
+    }
     
     if (!response.success) {
         std::cerr << "Failed to fetch " << item.url << ": " << response.error_message << std::endl;
@@ -187,100 +890,111 @@ bool Spider::processUrl(const UrlQueueItem& item) {
         return false;
     }
     
-    // Extract title and text content
-    std::string title = html_parser_->extractTitle(response.body);
-    std::string content = html_parser_->extractText(response.body);
+    // Servers without validators still let us skip pages whose body is unchanged
+    parsed.validators.content_hash = contentHash(response.body);
     
-    // Index the page
-    if (indexPage(item.url, title, content)) {
-        pages_indexed_++;
+    if (page.previous.document_id > 0 && page.previous.content_hash == parsed.validators.content_hash) {
+        parsed.unchanged = true;
+        return true;
     }
     
-    // Extract and queue new URLs if we haven't reached max depth
+    // Extract title, text content and links in one pass; relative links
+    // are relative to where the page was served from after redirects
+    const std::string& base_url = response.final_url.empty() ? item.url : response.final_url;
+    ParsedHtml html = html_parser_->parse(response.body, base_url);
+    parsed.title = std::move(html.title);
+    parsed.content = std::move(html.text);
+    parsed.links = std::move(html.links);
+    
+    // Queue new URLs if we haven't reached max depth
     if (item.depth < max_depth_) {
-        extractAndQueueUrls(response.body, item.url, item.depth);
+        queueLinks(parsed.links, item.url, item.depth);
     }
     
-    url_queue_->markProcessed(item.url);
+    // Copies of an indexed page (printable views, old revisions) skip tokenizing
+    // and indexing; very short pages are too alike to compare this way
+    size_t word_count = 0;
+    parsed.simhash = computeSimHash(parsed.content, &word_count);
+    if (word_count < MIN_SIMHASH_WORDS) {
+        parsed.simhash = 0;
+    } else if (simhash_index_) {
+        SimHashIndex::Match match = simhash_index_->findOrAdd(item.url, parsed.simhash);
+        if (match.distance >= 0) {
+            parsed.duplicate_of = match.url;
+            parsed.duplicate_distance = match.distance;
+            return true;
+        }
+    }
+    
+    // Tokenizing is CPU work, so it stays on this stage
+    text_indexer_->indexText(parsed.content, parsed.word_frequencies);
+    
     return true;
 }
 
-bool Spider::indexPage(const std::string& url, const std::string& title, 
-                      const std::string& content) {
+void Spider::processUnchanged(Database& database, const ParsedPage& page) {
+    database.touchDocument(page.previous.document_id, page.validators);
+    pages_unchanged_++;
+    
+    std::cout << "Unchanged since last crawl: " << page.item.url << std::endl;
+    
+    if (page.item.depth < max_depth_) {
+        queueLinks(database.getDocumentLinks(page.previous.document_id), page.item.url, page.item.depth);
+    }
+}
+
+bool Spider::indexPage(Database& database, const ParsedPage& page) {
+    const std::string& url = page.item.url;
     
-    // Insert document into database
-    int document_id = database_->insertDocument(url, title, content);
+    // Insert or replace the document together with its word frequencies
+    int document_id = database.storeDocument(url, page.title, page.content, page.validators, page.links,
+                                             static_cast<int64_t>(page.simhash), page.word_frequencies);
     if (document_id <= 0) {
         std::cerr << "Failed to insert document: " << url << std::endl;
         return false;
     }
     
-    // Index the content
-    std::map<std::string, int> word_frequencies = text_indexer_->indexText(content);
-    
-    // Store word frequencies in database
-    size_t words_count = 0;
-    for (const auto& pair : word_frequencies) {
-        const std::string& word = pair.first;
-        int frequency = pair.second;
-        
-        int word_id = database_->getOrCreateWord(word);
-        if (word_id > 0) {
-            if (database_->insertWordFrequency(document_id, word_id, frequency)) {
-                words_count += frequency;
-            }
-        }
-    }
-    
+    size_t words_count = page.word_frequencies.getTotalCount();
     total_words_indexed_ += words_count;
     
-    std::cout << "Indexed page: " << url << " (" << word_frequencies.size() 
+    std::cout << "Indexed page: " << url << " (" << page.word_frequencies.size() 
               << " unique words, " << words_count << " total words)" << std::endl;
     
     return true;
 }
 
-void Spider::extractAndQueueUrls(const std::string& html_content, 
-                                const std::string& base_url, int current_depth) {
+void Spider::queueLinks(const std::vector<std::string>& links, 
+                        const std::string& base_url, int current_depth) {
     
-    std::vector<std::string> links = html_parser_->extractLinks(html_content, base_url);
-    
-    int queued_count = 0;
+    std::vector<std::string> candidates;
+    candidates.reserve(links.size());
     for (const std::string& link : links) {
         if (shouldCrawlUrl(link)) {
-            if (url_queue_->enqueue(link, current_depth + 1)) {
-                queued_count++;
-            }
+            candidates.push_back(link);
         }
     }
     
+    // One batch per page keeps queue lock traffic independent of the link count
+    std::vector<std::string> accepted;
+    size_t queued_count = url_queue_->enqueueMany(candidates, current_depth + 1, &accepted);
+    
+    // Warm the DNS cache for hosts new to the frontier
+    for (const std::string& url : accepted) {
+        http_client_->prefetchHost(url);
+    }
+    
     if (queued_count > 0) {
         std::cout << "Queued " << queued_count << " new URLs from " << base_url << std::endl;
     }
 }
 
 bool Spider::shouldCrawlUrl(const std::string& url) const {
-    // Basic URL filtering
-    
-    // Must be HTTP or HTTPS
-    if (url.find("http://") != 0 && url.find("https://") != 0) {
+    if (!url_filter_->isAllowed(url)) {
         return false;
     }
     
-    // Skip common non-content files
-    std::vector<std::string> skip_extensions = {
-        ".css", ".js", ".jpg", ".jpeg", ".png", ".gif", ".pdf", 
-        ".zip", ".rar", ".exe", ".dmg", ".mp3", ".mp4", ".avi"
-    };
-    
-    for (const std::string& ext : skip_extensions) {
-        if (url.find(ext) != std::string::npos) {
-            return false;
-        }
-    }
-    
-    // Skip URLs that are too long
-    if (url.length() > 500) {
+    // Hosts whose robots.txt is not loaded yet are checked again before the fetch
+    if (robots_cache_ && !robots_cache_->isAllowed(url)) {
         return false;
     }
     
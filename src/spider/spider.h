@@ -2,23 +2,33 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <thread>
 #include <memory>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include "../common/config_parser.h"
 #include "../common/database.h"
 #include "../common/html_parser.h"
 #include "../common/text_indexer.h"
 #include "http_client.h"
 #include "url_queue.h"
+#include "robots_cache.h"
+#include "url_filter.h"
+#include "crawl_journal.h"
+#include "concurrency_controller.h"
+#include "simhash.h"
+#include "blocking_queue.h"
 
 class Spider {
 public:
     Spider();
     ~Spider();
     
-    // Initialize spider with configuration
-    bool initialize(const ConfigParser& config);
+    // Initialize spider with configuration; with resume set, the crawl
+    // continues from the checkpoint file instead of starting over
+    bool initialize(const ConfigParser& config, bool resume = false);
     
     // Start crawling from the configured start URL
     void startCrawling();
@@ -26,11 +36,39 @@ public:
     // Stop crawling
     void stopCrawling();
     
+    // Ask startCrawling() to stop and write a final checkpoint; only sets
+    // a flag, so it is safe to call from a signal handler
+    void requestStop();
+    
     // Get crawling statistics
     struct CrawlStats {
         size_t pages_crawled;
         size_t pages_indexed;
+        size_t pages_unchanged;
+        size_t pages_duplicate;
         size_t urls_in_queue;
+        size_t fetches_in_flight;
+        size_t fetch_concurrency;    // current adaptive limit on fetches in flight
+        size_t parse_queue_depth;
+        size_t parse_queue_peak;
+        size_t fetch_throttled;      // dispatcher waits on a full parse queue
+        size_t store_queue_depth;
+        size_t store_queue_peak;
+        size_t parse_throttled;      // parse thread waits on a full store queue
+        size_t fetch_time_us;        // summed over all fetches / parsed / stored pages
+        size_t parse_time_us;
+        size_t store_time_us;
+        size_t connections_acquired;
+        size_t connections_reused;
+        size_t tls_sessions_resumed;
+        size_t tls_full_handshakes;
+        size_t dns_cache_hits;
+        size_t dns_cache_misses;
+        size_t bytes_received;
+        size_t early_aborts;
+        size_t bytes_saved;
+        size_t robots_fetches;
+        size_t robots_blocked;
         size_t total_words_indexed;
         bool is_running;
     };
@@ -41,33 +79,148 @@ private:
     ConfigParser config_;
     std::unique_ptr<Database> database_;
     std::unique_ptr<HtmlParser> html_parser_;
-    std::unique_ptr<TextIndexer> text_indexer_;
+    std::unique_ptr<TextIndexer> text_indexer_;   // shared by all parse threads
     std::unique_ptr<HttpClient> http_client_;
     std::unique_ptr<UrlQueue> url_queue_;
+    std::unique_ptr<CrawlJournal> journal_;
+    std::unique_ptr<UrlFilter> url_filter_;
+    std::unique_ptr<RobotsCache> robots_cache_;   // null when robots.txt is ignored
+    std::unique_ptr<SimHashIndex> simhash_index_; // null when near-duplicates are indexed
+    
+    // Fetched page waiting to be parsed and indexed
+    struct FetchedPage {
+        UrlQueueItem item;
+        DocumentValidators previous;   // stored copy, if any
+        HttpResponse response;
+    };
+    
+    // Parsed page waiting to be written to the database
+    struct ParsedPage {
+        UrlQueueItem item{"", 0};
+        DocumentValidators previous;
+        DocumentValidators validators;
+        bool unchanged = false;   // only the stored validators need refreshing
+        uint64_t simhash = 0;     // 0 for pages too short to fingerprint
+        std::string duplicate_of; // indexed page this one nearly repeats, if any
+        int duplicate_distance = -1;
+        std::string title;
+        std::string content;
+        std::vector<std::string> links;
+        TermFrequencies word_frequencies;
+    };
+    
+    // Pipeline: lookup threads read the stored validators of dispatched
+    // URLs, I/O threads fetch, parse threads parse and tokenize, store
+    // threads write to the database. Bounded queues between the stages let
+    // a slow stage hold back the one before it.
+    std::thread dispatcher_thread_;
+    std::vector<std::thread> lookup_threads_;
+    std::vector<std::thread> parse_threads_;
+    std::vector<std::thread> store_threads_;
+    BlockingQueue<UrlQueueItem> lookups_;   // bounded by the fetch slots its items hold
+    BlockingQueue<FetchedPage> fetched_pages_;
+    BlockingQueue<ParsedPage> parsed_pages_;
     
-    std::vector<std::thread> worker_threads_;
+    // One connection per lookup and per store thread
+    std::vector<std::unique_ptr<Database>> lookup_databases_;
+    std::vector<std::unique_ptr<Database>> store_databases_;
     std::atomic<bool> running_;
+    std::atomic<bool> stop_requested_;
     std::atomic<size_t> pages_crawled_;
     std::atomic<size_t> pages_indexed_;
+    std::atomic<size_t> pages_unchanged_;
+    std::atomic<size_t> pages_duplicate_;
     std::atomic<size_t> total_words_indexed_;
     
+    // URLs taken from the queue whose processing has not finished yet
+    std::atomic<size_t> outstanding_urls_;
+    
+    // Bound on concurrent fetches handed to the HTTP client, adjusted to
+    // the observed fetch latency and error rate
+    ConcurrencyController concurrency_;
+    std::mutex in_flight_mutex_;
+    std::condition_variable in_flight_condition_;
+    size_t in_flight_;
+    size_t peak_in_flight_;   // most in flight since the last completed fetch
+    std::atomic<size_t> fetch_throttled_;   // waits caused by a full parse queue
+    
+    // Time spent in each stage, summed over pages
+    std::atomic<size_t> fetch_time_us_;
+    std::atomic<size_t> parse_time_us_;
+    std::atomic<size_t> store_time_us_;
+    
     int max_depth_;
-    int num_threads_;
+    int num_lookup_threads_;
+    int num_parse_threads_;
+    int num_store_threads_;
+    size_t parse_queue_size_;
+    size_t store_queue_size_;
+    int io_threads_;
+    int max_in_flight_;
+    int crawl_delay_ms_;
+    int max_connections_per_host_;
+    int checkpoint_interval_;
+    bool resume_;
+    bool conditional_recrawl_;
     std::string start_url_;
     
-    // Worker thread function
-    void workerThread();
+    // Restore state from the checkpoint (when resuming) and start journaling
+    void openCheckpoint();
+    
+    // Load a snapshot into the queue and counters
+    void restoreSnapshot(const CrawlJournal::Snapshot& snapshot);
+    
+    // Append progress since the last checkpoint to the journal
+    void writeCheckpoint();
+    
+    // Dequeue URLs and start asynchronous fetches
+    void dispatcherThread();
+    
+    // Lookup stage: ask for dispatched URLs only if they changed since
+    // they were stored, then fetch them
+    void lookupThread(Database& database);
+    
+    // Parse stage: extract and tokenize fetched pages
+    void parseThread();
+    
+    // Store stage: write parsed pages through database
+    void storeThread(Database& database);
+    
+    // Check whether a dequeued URL should be fetched at all
+    bool prepareUrl(const UrlQueueItem& item);
+    
+    // Fetch a dispatched URL once robots.txt allows it
+    void checkRobotsAndFetch(const UrlQueueItem& item, const DocumentValidators& previous,
+                             const HttpClient::RequestHeaders& headers);
+    
+    // Fetch a dequeued URL that holds a fetch slot
+    void startFetch(const UrlQueueItem& item, const DocumentValidators& previous,
+                    const HttpClient::RequestHeaders& headers);
+    
+    // Drop a dequeued URL that robots.txt disallows and free its fetch slot
+    void onRobotsBlocked(const UrlQueueItem& item);
+    
+    // Requeue a dequeued URL whose robots.txt could not be fetched for
+    // after the retry delay and free its fetch slot
+    void onRobotsUnavailable(const UrlQueueItem& item);
+    
+    // Called on an I/O thread when a fetch completes
+    void onFetchComplete(const UrlQueueItem& item, const DocumentValidators& previous,
+                         HttpResponse response, std::chrono::milliseconds latency);
+    
+    // Parse a fetched page; false if it is dropped here (failed or not HTML)
+    bool parsePage(const FetchedPage& page, ParsedPage& parsed);
     
-    // Process a single URL
-    bool processUrl(const UrlQueueItem& item);
+    // Handle a page found unchanged since it was stored: refresh its
+    // validators and follow its stored links without re-parsing
+    void processUnchanged(Database& database, const ParsedPage& page);
     
-    // Index a page and store in database
-    bool indexPage(const std::string& url, const std::string& title, 
-                   const std::string& content);
+    // Store a parsed page with its word frequencies
+    bool indexPage(Database& database, const ParsedPage& page);
     
-    // Extract and queue new URLs from page content
-    void extractAndQueueUrls(const std::string& html_content, 
-                            const std::string& base_url, int current_depth);
+    // Queue the crawlable URLs among links found on base_url
+    void queueLinks(const std::vector<std::string>& links, 
+                    const std::string& base_url, int current_depth);
     
     // Check if URL should be crawled
     bool shouldCrawlUrl(const std::string& url) const;
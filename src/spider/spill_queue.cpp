@@ -0,0 +1,235 @@
+#include "spill_queue.h"
+#include "url_queue.h"
+#include <iostream>
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Longest URL a record may hold; a larger length read back means the
+// segment is corrupt
+const uint32_t MAX_RECORD_URL_BYTES = 64 * 1024;
+
+}
+
+SpillQueue::SpillQueue(const std::string& directory, size_t segment_items)
+    : directory_(directory)
+    , segment_items_(segment_items > 0 ? segment_items : 1)
+    , writer_items_(0)
+    , next_segment_id_(0)
+    , write_failed_(false)
+    , loading_(false)
+    , size_(0)
+    , stopped_(false) {
+
+    // Segments from an earlier run are stale; the frontier is rebuilt from scratch
+    std::error_code ec;
+    fs::create_directories(directory_, ec);
+    removeSegments();
+    if (ec) {
+        std::cerr << "Cannot create frontier spill directory " << directory_ << ": " << ec.message() << std::endl;
+    }
+
+    prefetch_thread_ = std::thread(&SpillQueue::prefetchLoop, this);
+}
+
+SpillQueue::~SpillQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    prefetch_condition_.notify_all();
+    ready_condition_.notify_all();
+
+    if (prefetch_thread_.joinable()) {
+        prefetch_thread_.join();
+    }
+
+    writer_.close();
+    removeSegments();
+}
+
+bool SpillQueue::push(const UrlQueueItem& item) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (item.url.size() > MAX_RECORD_URL_BYTES) {
+        return false;
+    }
+
+    if (!writer_.is_open()) {
+        writer_path_ = (fs::path(directory_) / ("segment_" + std::to_string(next_segment_id_++) + ".dat")).string();
+        writer_.clear();
+        writer_.open(writer_path_, std::ios::binary | std::ios::trunc);
+        writer_items_ = 0;
+        if (!writer_.is_open()) {
+            if (!write_failed_) {
+                std::cerr << "Cannot create frontier segment " << writer_path_
+                          << "; keeping URLs in memory" << std::endl;
+                write_failed_ = true;
+            }
+            return false;
+        }
+    }
+
+    // Record: depth, URL length, URL bytes
+    uint32_t depth = static_cast<uint32_t>(item.depth);
+    uint32_t length = static_cast<uint32_t>(item.url.size());
+    writer_.write(reinterpret_cast<const char*>(&depth), sizeof(depth));
+    writer_.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    writer_.write(item.url.data(), length);
+
+    if (!writer_) {
+        // The records before this one stay counted; any of them still
+        // buffered are found missing when the segment is read back
+        if (!write_failed_) {
+            std::cerr << "Cannot write frontier segment " << writer_path_
+                      << "; keeping URLs in memory" << std::endl;
+            write_failed_ = true;
+        }
+        sealWriter();
+        return false;
+    }
+    write_failed_ = false;
+
+    writer_items_++;
+    size_++;
+
+    if (writer_items_ >= segment_items_) {
+        sealWriter();
+    }
+    return true;
+}
+
+size_t SpillQueue::popBatch(std::vector<UrlQueueItem>& out, size_t max_items, bool wait) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (buffer_.empty() && sealed_segments_.empty() && !loading_ && writer_items_ > 0) {
+        // Only the open segment has data left; hand it to the reader
+        sealWriter();
+    }
+
+    if (wait) {
+        ready_condition_.wait(lock, [this] {
+            return !buffer_.empty() || stopped_ || (sealed_segments_.empty() && !loading_);
+        });
+    }
+
+    size_t count = 0;
+    while (count < max_items && !buffer_.empty()) {
+        out.push_back(std::move(buffer_.front()));
+        buffer_.pop_front();
+        count++;
+    }
+    size_ -= count;
+
+    if (count > 0) {
+        // Room for the next segment
+        prefetch_condition_.notify_one();
+    }
+
+    return count;
+}
+
+size_t SpillQueue::size() const {
+    return size_.load();
+}
+
+bool SpillQueue::empty() const {
+    return size_.load() == 0;
+}
+
+void SpillQueue::sealWriter() {
+    if (!writer_.is_open()) {
+        return;
+    }
+
+    writer_.close();
+    if (writer_items_ > 0) {
+        sealed_segments_.push_back({writer_path_, writer_items_});
+    } else {
+        std::error_code ec;
+        fs::remove(writer_path_, ec);
+    }
+    writer_items_ = 0;
+    prefetch_condition_.notify_one();
+}
+
+void SpillQueue::prefetchLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!stopped_) {
+        // Keep at most one segment loaded beyond what is being consumed
+        prefetch_condition_.wait(lock, [this] {
+            return stopped_ || (!sealed_segments_.empty() && buffer_.size() < segment_items_);
+        });
+
+        if (stopped_) {
+            break;
+        }
+
+        Segment segment = sealed_segments_.front();
+        sealed_segments_.pop_front();
+        loading_ = true;
+
+        lock.unlock();
+        std::deque<UrlQueueItem> loaded;
+        // A segment whose last write failed ends inside a record; only the
+        // records missing from it count as lost
+        readSegment(segment.path, loaded);
+        std::error_code ec;
+        fs::remove(segment.path, ec);
+        lock.lock();
+
+        loading_ = false;
+        size_t lost = segment.items > loaded.size() ? segment.items - loaded.size() : 0;
+        if (lost > 0) {
+            // Records that could not be read back are gone; drop them from the
+            // count so the queue can still drain to empty
+            std::cerr << "Failed to read frontier segment " << segment.path << ": "
+                      << lost << " of " << segment.items << " URLs lost" << std::endl;
+            size_ -= lost;
+        }
+        for (auto& item : loaded) {
+            buffer_.push_back(std::move(item));
+        }
+
+        ready_condition_.notify_all();
+    }
+}
+
+void SpillQueue::removeSegments() {
+    // Only touch files we could have written; the directory may be shared
+    std::error_code ec;
+    for (fs::directory_iterator it(directory_, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (name.rfind("segment_", 0) == 0 && it->path().extension() == ".dat") {
+            std::error_code remove_ec;
+            fs::remove(it->path(), remove_ec);
+        }
+    }
+}
+
+bool SpillQueue::readSegment(const std::string& path, std::deque<UrlQueueItem>& out) {
+    std::ifstream reader(path, std::ios::binary);
+    if (!reader.is_open()) {
+        return false;
+    }
+
+    uint32_t depth = 0;
+    uint32_t length = 0;
+    while (reader.read(reinterpret_cast<char*>(&depth), sizeof(depth))) {
+        if (!reader.read(reinterpret_cast<char*>(&length), sizeof(length)) || length > MAX_RECORD_URL_BYTES) {
+            return false;
+        }
+        std::string url(length, '\0');
+        if (!reader.read(&url[0], length)) {
+            return false;
+        }
+        out.emplace_back(url, static_cast<int>(depth));
+    }
+
+    // A read that stopped short of the end of file is an error too
+    return reader.eof() && reader.gcount() == 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+struct UrlQueueItem;
+
+// FIFO of frontier entries kept on local disk. Items are appended to
+// fixed-size segment files; sealed segments are read back in order by a
+// background thread that keeps the next segment loaded ahead of demand,
+// so memory stays bounded by about two segments no matter the queue length.
+class SpillQueue {
+public:
+    SpillQueue(const std::string& directory, size_t segment_items);
+    ~SpillQueue();
+
+    SpillQueue(const SpillQueue&) = delete;
+    SpillQueue& operator=(const SpillQueue&) = delete;
+
+    // Append item to the tail; false if it could not be written (e.g. the
+    // directory is missing or the disk is full), in which case the caller
+    // keeps the item. Records still buffered when a later write fails are
+    // lost and dropped from size() when their segment is read back.
+    bool push(const UrlQueueItem& item);
+
+    // Move up to max_items from the head into out. With wait set, blocks
+    // until at least one item is available unless the queue is empty.
+    size_t popBatch(std::vector<UrlQueueItem>& out, size_t max_items, bool wait);
+
+    // Number of items on disk or loaded but not yet popped
+    size_t size() const;
+    bool empty() const;
+
+private:
+    std::string directory_;
+    size_t segment_items_;
+
+    std::ofstream writer_;
+    std::string writer_path_;
+    size_t writer_items_;
+    size_t next_segment_id_;
+    bool write_failed_;   // the last push failed; reported once until one succeeds
+
+    // Closed segment file and the number of records written to it
+    struct Segment {
+        std::string path;
+        size_t items;
+    };
+
+    std::deque<Segment> sealed_segments_;
+    std::deque<UrlQueueItem> buffer_;
+    bool loading_;
+
+    std::atomic<size_t> size_;
+    bool stopped_;
+
+    std::thread prefetch_thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable prefetch_condition_;
+    std::condition_variable ready_condition_;
+
+    // Close the segment being written so it can be read; caller holds mutex_
+    void sealWriter();
+
+    // Background loop that loads sealed segments into buffer_
+    void prefetchLoop();
+
+    // Delete segment files left in directory_
+    void removeSegments();
+
+    // Append the records of the segment at path to out; false if the file
+    // cannot be opened, ends inside a record or holds an impossible URL
+    // length (out keeps the records read)
+    static bool readSegment(const std::string& path, std::deque<UrlQueueItem>& out);
+};
@@ -0,0 +1,88 @@
+#include "tls_session_cache.h"
+#include <ctime>
+
+TlsSessionCache::TlsSessionCache(size_t max_entries)
+    : max_entries_(max_entries > 0 ? max_entries : 1)
+    , hits_(0)
+    , misses_(0) {
+}
+
+TlsSessionCache::~TlsSessionCache() {
+    for (auto& pair : sessions_) {
+        SSL_SESSION_free(pair.second.session);
+    }
+}
+
+bool TlsSessionCache::apply(const std::string& key, SSL* ssl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = sessions_.find(key);
+    if (it == sessions_.end()) {
+        return false;
+    }
+
+    // Drop sessions the server would refuse anyway
+    SSL_SESSION* session = it->second.session;
+    if (SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session) < static_cast<long>(std::time(nullptr))) {
+        erase(it);
+        return false;
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+    return SSL_set_session(ssl, session) == 1;
+}
+
+void TlsSessionCache::store(const std::string& key, SSL* ssl) {
+    SSL_SESSION* current = SSL_get_session(ssl);
+    if (!current || !SSL_SESSION_is_resumable(current)) {
+        return;
+    }
+
+    // Keep a private copy: OpenSSL marks a connection's own session as not
+    // resumable when the connection is closed without a TLS shutdown
+    SSL_SESSION* session = SSL_SESSION_dup(current);
+    if (!session) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = sessions_.find(key);
+    if (it != sessions_.end()) {
+        SSL_SESSION_free(it->second.session);
+        it->second.session = session;
+        lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+        return;
+    }
+
+    lru_.push_front(key);
+    sessions_.emplace(key, Entry{session, lru_.begin()});
+
+    while (sessions_.size() > max_entries_) {
+        erase(sessions_.find(lru_.back()));
+    }
+}
+
+void TlsSessionCache::recordHandshake(SSL* ssl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (SSL_session_reused(ssl)) {
+        hits_++;
+    } else {
+        misses_++;
+    }
+}
+
+TlsSessionCache::Stats TlsSessionCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.entries = sessions_.size();
+    return stats;
+}
+
+void TlsSessionCache::erase(std::unordered_map<std::string, Entry>::iterator it) {
+    SSL_SESSION_free(it->second.session);
+    lru_.erase(it->second.lru_position);
+    sessions_.erase(it);
+}
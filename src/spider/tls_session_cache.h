@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <openssl/ssl.h>
+
+// Client-side TLS session cache keyed by host:port. Sessions (tickets or
+// IDs) saved from earlier connections are offered on reconnect so the
+// server can resume them with an abbreviated handshake.
+class TlsSessionCache {
+public:
+    explicit TlsSessionCache(size_t max_entries = 1024);
+    ~TlsSessionCache();
+
+    TlsSessionCache(const TlsSessionCache&) = delete;
+    TlsSessionCache& operator=(const TlsSessionCache&) = delete;
+
+    // Offer a cached session for key on ssl before the handshake.
+    // Returns true if a session was set.
+    bool apply(const std::string& key, SSL* ssl);
+
+    // Save the session negotiated on ssl (call once the connection has
+    // exchanged data, so TLS 1.3 tickets have arrived)
+    void store(const std::string& key, SSL* ssl);
+
+    // Record the outcome of a completed handshake
+    void recordHandshake(SSL* ssl);
+
+    struct Stats {
+        size_t hits;      // handshakes resumed from a cached session
+        size_t misses;    // full handshakes
+        size_t entries;
+    };
+
+    Stats getStats() const;
+
+private:
+    struct Entry {
+        SSL_SESSION* session;
+        std::list<std::string>::iterator lru_position;
+    };
+
+    std::unordered_map<std::string, Entry> sessions_;
+    std::list<std::string> lru_;   // most recently used first
+    size_t max_entries_;
+    size_t hits_;
+    size_t misses_;
+    mutable std::mutex mutex_;
+
+    void erase(std::unordered_map<std::string, Entry>::iterator it);
+};
@@ -0,0 +1,251 @@
+#include "url_filter.h"
+#include "../common/url.h"
+#include <algorithm>
+#include <map>
+
+namespace {
+
+inline bool isUpper(char c) {
+    return c >= 'A' && c <= 'Z';
+}
+
+inline char toLower(char c) {
+    return isUpper(c) ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+// text lower-cased; scratch is only written when text has upper-case letters
+std::string_view lowerCase(std::string_view text, std::string& scratch) {
+    if (std::none_of(text.begin(), text.end(), isUpper)) {
+        return text;
+    }
+    scratch.assign(text.begin(), text.end());
+    std::transform(scratch.begin(), scratch.end(), scratch.begin(), toLower);
+    return scratch;
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return toLower(x) == toLower(y); });
+}
+
+// "*.Example.com." and ".example.com" both become "example.com"
+std::string normalizeDomain(std::string domain) {
+    std::transform(domain.begin(), domain.end(), domain.begin(), toLower);
+    if (domain.compare(0, 2, "*.") == 0) {
+        domain.erase(0, 2);
+    } else if (!domain.empty() && domain[0] == '.') {
+        domain.erase(0, 1);
+    }
+    if (!domain.empty() && domain.back() == '.') {
+        domain.pop_back();
+    }
+    return domain;
+}
+
+// "PDF" and ".pdf" both become "pdf"
+std::string normalizeExtension(std::string extension) {
+    std::transform(extension.begin(), extension.end(), extension.begin(), toLower);
+    if (!extension.empty() && extension[0] == '.') {
+        extension.erase(0, 1);
+    }
+    return extension;
+}
+
+}
+
+std::vector<std::string> UrlFilter::Rules::defaultSkipExtensions() {
+    return {
+        "css", "js", "jpg", "jpeg", "png", "gif", "pdf",
+        "zip", "rar", "exe", "dmg", "mp3", "mp4", "avi"
+    };
+}
+
+UrlFilter::UrlFilter(const Rules& rules)
+    : max_extension_length_(0)
+    , max_url_length_(rules.max_url_length)
+    , rule_count_(0) {
+    for (const std::string& domain : rules.allow_domains) {
+        storage_.push_back(normalizeDomain(domain));
+        allow_domains_.insert(storage_.back());
+    }
+    for (const std::string& domain : rules.deny_domains) {
+        storage_.push_back(normalizeDomain(domain));
+        deny_domains_.insert(storage_.back());
+    }
+    for (const std::string& extension : rules.skip_extensions) {
+        storage_.push_back(normalizeExtension(extension));
+        skip_extensions_.insert(storage_.back());
+        max_extension_length_ = std::max(max_extension_length_, storage_.back().size());
+    }
+
+    allow_prefixes_.build(rules.allow_path_prefixes, false);
+    deny_prefixes_.build(rules.deny_path_prefixes, false);
+    deny_suffixes_.build(rules.deny_path_suffixes, true);
+
+    if (!rules.deny_regex.empty()) {
+        deny_regex_ = std::make_unique<std::regex>(rules.deny_regex,
+                                                   std::regex::ECMAScript | std::regex::optimize);
+    }
+
+    rule_count_ = allow_domains_.size() + deny_domains_.size() + skip_extensions_.size() +
+                  rules.allow_path_prefixes.size() + rules.deny_path_prefixes.size() +
+                  rules.deny_path_suffixes.size() + (deny_regex_ ? 1 : 0);
+}
+
+UrlFilter::Verdict UrlFilter::classify(std::string_view url) const {
+    if (url.size() > max_url_length_) {
+        return Verdict::Length;
+    }
+
+    UrlView parts;
+    if (!parseUrlReference(url, parts) || !parts.has_authority || parts.host.empty() ||
+        !(equalsIgnoreCase(parts.scheme, "http") || equalsIgnoreCase(parts.scheme, "https"))) {
+        return Verdict::Scheme;
+    }
+
+    std::string scratch;
+    if (!allow_domains_.empty() || !deny_domains_.empty()) {
+        std::string_view host = lowerCase(parts.host, scratch);
+        if (!allow_domains_.empty() && !matchesDomain(allow_domains_, host)) {
+            return Verdict::Domain;
+        }
+        if (matchesDomain(deny_domains_, host)) {
+            return Verdict::Domain;
+        }
+    }
+
+    // Extension of the last path segment only: "/docs.json/page" and
+    // "/jsonify" have none
+    std::string_view path = parts.path.empty() ? std::string_view("/") : parts.path;
+    if (!skip_extensions_.empty()) {
+        std::string_view segment = path.substr(path.rfind('/') + 1);
+        size_t dot = segment.rfind('.');
+        if (dot != std::string_view::npos) {
+            std::string_view extension = segment.substr(dot + 1);
+            if (!extension.empty() && extension.size() <= max_extension_length_ &&
+                skip_extensions_.count(lowerCase(extension, scratch)) > 0) {
+                return Verdict::Extension;
+            }
+        }
+    }
+
+    // Path and query are contiguous in the URL text
+    std::string_view path_and_query = path;
+    if (parts.has_query && !parts.path.empty()) {
+        path_and_query = std::string_view(parts.path.data(),
+                                          parts.query.data() + parts.query.size() - parts.path.data());
+    }
+    if (deny_prefixes_.matches(path_and_query) || deny_suffixes_.matches(path)) {
+        return Verdict::Path;
+    }
+    if (!allow_prefixes_.empty() && !allow_prefixes_.matches(path_and_query)) {
+        return Verdict::Path;
+    }
+
+    if (deny_regex_ && std::regex_search(url.begin(), url.end(), *deny_regex_)) {
+        return Verdict::Pattern;
+    }
+
+    return Verdict::Allowed;
+}
+
+const char* UrlFilter::getVerdictName(Verdict verdict) {
+    switch (verdict) {
+        case Verdict::Allowed: return "allowed";
+        case Verdict::Scheme: return "scheme";
+        case Verdict::Length: return "length";
+        case Verdict::Domain: return "domain";
+        case Verdict::Extension: return "extension";
+        case Verdict::Path: return "path";
+        case Verdict::Pattern: return "pattern";
+    }
+    return "unknown";
+}
+
+bool UrlFilter::matchesDomain(const std::unordered_set<std::string_view>& domains, std::string_view host) {
+    if (domains.empty()) {
+        return false;
+    }
+    if (!host.empty() && host.back() == '.') {
+        host.remove_suffix(1);
+    }
+    while (true) {
+        if (domains.count(host) > 0) {
+            return true;
+        }
+        size_t dot = host.find('.');
+        if (dot == std::string_view::npos) {
+            return false;
+        }
+        host.remove_prefix(dot + 1);
+    }
+}
+
+void UrlFilter::PatternTrie::build(const std::vector<std::string>& patterns, bool reversed) {
+    reversed_ = reversed;
+
+    // Build with sorted child maps, then flatten each node's edges into one run
+    struct BuildNode {
+        std::map<unsigned char, unsigned> children;
+        bool terminal = false;
+    };
+    std::vector<BuildNode> build_nodes(1);
+    for (const std::string& pattern : patterns) {
+        if (pattern.empty()) {
+            continue;
+        }
+        unsigned node = 0;
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            unsigned char byte = static_cast<unsigned char>(reversed ? pattern[pattern.size() - 1 - i] : pattern[i]);
+            auto child = build_nodes[node].children.find(byte);
+            if (child == build_nodes[node].children.end()) {
+                unsigned target = static_cast<unsigned>(build_nodes.size());
+                build_nodes[node].children[byte] = target;
+                build_nodes.emplace_back();
+                node = target;
+            } else {
+                node = child->second;
+            }
+        }
+        build_nodes[node].terminal = true;
+    }
+
+    nodes_.assign(build_nodes.size(), Node());
+    edges_.clear();
+    for (size_t i = 0; i < build_nodes.size(); ++i) {
+        nodes_[i].first_edge = static_cast<unsigned>(edges_.size());
+        nodes_[i].edge_count = static_cast<unsigned>(build_nodes[i].children.size());
+        nodes_[i].terminal = build_nodes[i].terminal;
+        for (const auto& child : build_nodes[i].children) {
+            edges_.push_back({child.first, child.second});
+        }
+    }
+}
+
+bool UrlFilter::PatternTrie::matches(std::string_view text) const {
+    if (empty()) {
+        return false;
+    }
+    unsigned node = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        int target = next(node, static_cast<unsigned char>(reversed_ ? text[text.size() - 1 - i] : text[i]));
+        if (target < 0) {
+            return false;
+        }
+        node = static_cast<unsigned>(target);
+        if (nodes_[node].terminal) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int UrlFilter::PatternTrie::next(unsigned node, unsigned char byte) const {
+    const Node& current = nodes_[node];
+    for (unsigned i = current.first_edge; i < current.first_edge + current.edge_count; ++i) {
+        if (edges_[i].byte == byte) {
+            return static_cast<int>(edges_[i].target);
+        }
+    }
+    return -1;
+}
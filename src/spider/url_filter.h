@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_set>
+#include <memory>
+#include <regex>
+
+// Crawl rules for discovered links, compiled once so that each URL is
+// classified with a single parse and a handful of lookups:
+// - domains: hash set of host names; a rule also covers its subdomains
+// - extensions: hash set keyed by the extension of the last path segment
+// - path prefixes and suffixes: byte tries walked forwards / backwards
+// - an optional regex, only tried on URLs every other rule let through
+// Const after construction, so one filter is shared by all threads.
+class UrlFilter {
+public:
+    struct Rules {
+        std::vector<std::string> allow_domains;        // if set, only these hosts
+        std::vector<std::string> deny_domains;
+        std::vector<std::string> skip_extensions;      // without the dot, e.g. "pdf"
+        std::vector<std::string> allow_path_prefixes;  // if set, only these paths
+        std::vector<std::string> deny_path_prefixes;   // matched against path and query
+        std::vector<std::string> deny_path_suffixes;   // matched against the path
+        std::string deny_regex;                        // ECMAScript, searched in the whole URL
+        size_t max_url_length = 500;
+
+        // Extensions of files the spider never indexes (images, archives, media, ...)
+        static std::vector<std::string> defaultSkipExtensions();
+    };
+
+    // Why a URL was rejected
+    enum class Verdict {
+        Allowed,
+        Scheme,       // not http(s), or no host
+        Length,
+        Domain,
+        Extension,
+        Path,
+        Pattern
+    };
+
+    // Throws std::regex_error if deny_regex does not compile
+    explicit UrlFilter(const Rules& rules);
+    UrlFilter(const UrlFilter&) = delete;
+    UrlFilter& operator=(const UrlFilter&) = delete;
+
+    Verdict classify(std::string_view url) const;
+    bool isAllowed(std::string_view url) const { return classify(url) == Verdict::Allowed; }
+
+    size_t getRuleCount() const { return rule_count_; }
+
+    static const char* getVerdictName(Verdict verdict);
+
+private:
+    // Byte trie over a set of patterns; each node's edges are contiguous
+    // in edges_, so a walk is a short linear scan per input byte
+    class PatternTrie {
+    public:
+        void build(const std::vector<std::string>& patterns, bool reversed);
+        bool empty() const { return nodes_.size() <= 1; }
+
+        // Does some pattern match the start (or, if built reversed, the end) of text?
+        bool matches(std::string_view text) const;
+
+    private:
+        struct Node {
+            unsigned first_edge = 0;
+            unsigned edge_count = 0;
+            bool terminal = false;
+        };
+        struct Edge {
+            unsigned char byte;
+            unsigned target;
+        };
+
+        std::vector<Node> nodes_;
+        std::vector<Edge> edges_;
+        bool reversed_ = false;
+
+        int next(unsigned node, unsigned char byte) const;
+    };
+
+    // Owns the strings the string_view sets point into; a deque never
+    // moves its elements, so the views stay valid
+    std::deque<std::string> storage_;
+    std::unordered_set<std::string_view> allow_domains_;
+    std::unordered_set<std::string_view> deny_domains_;
+    std::unordered_set<std::string_view> skip_extensions_;
+    size_t max_extension_length_;
+    PatternTrie allow_prefixes_;
+    PatternTrie deny_prefixes_;
+    PatternTrie deny_suffixes_;
+    std::unique_ptr<std::regex> deny_regex_;
+    size_t max_url_length_;
+    size_t rule_count_;
+
+    // host or any parent domain of it in domains
+    static bool matchesDomain(const std::unordered_set<std::string_view>& domains, std::string_view host);
+};
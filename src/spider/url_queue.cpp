@@ -1,63 +1,243 @@
 #include "url_queue.h"
+#include "crawl_journal.h"
+#include "../common/url.h"
 #include <algorithm>
+#include <utility>
 
-UrlQueue::UrlQueue() : stopped_(false) {
+UrlQueue::UrlQueue()
+    : pending_count_(0)
+    , crawl_delay_(100)
+    , max_active_per_host_(4)
+    , memory_limit_(0)
+    , processed_count_(0)
+    , journal_(nullptr)
+    , stopped_(false) {
+    setSeenSetOptions(SeenSetOptions());
 }
 
 UrlQueue::~UrlQueue() {
     stop();
 }
 
-bool UrlQueue::enqueue(const std::string& url, int depth) {
-    std::string normalized_url = normalizeUrl(url);
+void UrlQueue::setPoliteness(std::chrono::milliseconds crawl_delay, int max_active_per_host) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    crawl_delay_ = crawl_delay;
+    max_active_per_host_ = std::max(1, max_active_per_host);
+}
+
+void UrlQueue::setHostCrawlDelay(const std::string& url, std::chrono::milliseconds crawl_delay) {
+    std::string host = hostKey(normalizeUrl(url));
     
     std::lock_guard<std::mutex> lock(mutex_);
+    host_crawl_delays_[host] = crawl_delay;
+}
+
+void UrlQueue::setSeenSetOptions(const SeenSetOptions& options) {
+    for (SeenShard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.urls = createSeenSet(options, SHARD_COUNT);
+    }
+}
+
+void UrlQueue::setJournal(CrawlJournal* journal) {
+    journal_ = journal;
+}
+
+void UrlQueue::enableSpill(const std::string& directory, size_t memory_items) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    memory_limit_ = std::max<size_t>(2, memory_items);
     
-    // Check if URL is already processed or queued
-    if (processed_urls_.count(normalized_url) > 0 || 
-        queued_urls_.count(normalized_url) > 0) {
-        return false;
+    // Segments of a quarter of the memory budget keep reads sequential and
+    // the prefetched segment small next to the in-memory head
+    spill_ = std::make_unique<SpillQueue>(directory, std::max<size_t>(1, memory_limit_ / 4));
+}
+
+bool UrlQueue::enqueue(const std::string& url, int depth) {
+    return enqueueMany({url}, depth) > 0;
+}
+
+size_t UrlQueue::enqueueMany(const std::vector<std::string>& urls, int depth,
+                             std::vector<std::string>* accepted) {
+    // Normalize and bucket by shard without holding any lock
+    std::vector<std::vector<std::pair<std::string, std::string>>> by_shard(SHARD_COUNT);
+    std::hash<std::string> hasher;
+    for (const std::string& url : urls) {
+        std::string normalized_url = normalizeUrl(url);
+        std::string key = seenKey(normalized_url);
+        size_t shard = hasher(key) % SHARD_COUNT;
+        by_shard[shard].emplace_back(std::move(key), std::move(normalized_url));
     }
     
-    // Add to queue and mark as queued
-    queue_.emplace(normalized_url, depth);
-    queued_urls_.insert(normalized_url);
+    // Keep only URLs not seen before, marking them as queued
+    std::vector<UrlQueueItem> items;
+    for (size_t shard = 0; shard < SHARD_COUNT; ++shard) {
+        if (by_shard[shard].empty()) {
+            continue;
+        }
+        
+        std::lock_guard<std::mutex> lock(shards_[shard].mutex);
+        for (auto& url : by_shard[shard]) {
+            if (shards_[shard].urls->insert(url.first)) {
+                items.emplace_back(std::move(url.second), depth);
+            }
+        }
+    }
     
-    condition_.notify_one();
-    return true;
+    if (items.empty()) {
+        return 0;
+    }
+    
+    if (accepted) {
+        for (const UrlQueueItem& item : items) {
+            accepted->push_back(item.url);
+        }
+    }
+    
+    // Journal before scheduling so a URL's queued record always precedes
+    // its processed record
+    if (CrawlJournal* journal = journal_.load()) {
+        journal->recordQueued(items);
+    }
+    
+    size_t count = items.size();
+    schedule(items);
+    return count;
 }
 
-bool UrlQueue::dequeue(UrlQueueItem& item) {
-    std::unique_lock<std::mutex> lock(mutex_);
+void UrlQueue::schedule(std::vector<UrlQueueItem>& items) {
+    std::lock_guard<std::mutex> lock(mutex_);
     
-    // Wait until queue has items or is stopped
-    condition_.wait(lock, [this] { return !queue_.empty() || stopped_; });
+    for (UrlQueueItem& item : items) {
+        // Once anything is on disk, newer URLs queue behind it to keep FIFO
+        // order; a URL that cannot be spilled stays in memory
+        if (spill_ && (pending_count_ >= memory_limit_ || !spill_->empty()) && spill_->push(item)) {
+            continue;
+        }
+        addPending(std::move(item));
+    }
+}
+
+void UrlQueue::addPending(UrlQueueItem item) {
+    std::string host = hostKey(item.url);
+    HostState& state = hosts_[host];
+    state.pending.push_back(std::move(item));
+    pending_count_++;
+    scheduleHost(host, state);
+}
+
+void UrlQueue::refillFromSpill(std::unique_lock<std::mutex>& lock) {
+    if (!spill_ || spill_->empty() || pending_count_ >= memory_limit_ / 2) {
+        return;
+    }
     
-    if (stopped_ && queue_.empty()) {
-        return false;
+    // Only block on disk when there is nothing else to hand out
+    bool wait = (pending_count_ == 0);
+    std::vector<UrlQueueItem> batch;
+    
+    if (wait) {
+        lock.unlock();
+        spill_->popBatch(batch, memory_limit_ / 2, true);
+        lock.lock();
+    } else {
+        spill_->popBatch(batch, memory_limit_ - pending_count_, false);
     }
     
-    if (!queue_.empty()) {
-        item = queue_.front();
-        queue_.pop();
+    for (UrlQueueItem& item : batch) {
+        addPending(std::move(item));
+    }
+}
+
+bool UrlQueue::dequeue(UrlQueueItem& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    
+    while (!stopped_) {
+        refillFromSpill(lock);
+        
+        if (ready_hosts_.empty()) {
+            condition_.wait(lock);
+            continue;
+        }
+        
+        auto now = std::chrono::steady_clock::now();
+        ReadyEntry next = ready_hosts_.top();
+        if (next.first > now) {
+            // Earliest host is still cooling down
+            condition_.wait_until(lock, next.first);
+            continue;
+        }
         
-        // Remove from queued set (it will be added to processed when marked)
-        queued_urls_.erase(item.url);
+        ready_hosts_.pop();
+        HostState& state = hosts_[next.second];
+        state.scheduled = false;
         
+        if (state.pending.empty() || state.active >= max_active_per_host_) {
+            continue;
+        }
+        if (state.next_ready > now) {
+            // Held back by retryLater() after this entry was scheduled
+            scheduleHost(next.second, state);
+            continue;
+        }
+        
+        item = std::move(state.pending.front());
+        state.pending.pop_front();
+        pending_count_--;
+        
+        state.active++;
+        state.next_ready = now + crawlDelayFor(next.second);
+        scheduleHost(next.second, state);
         return true;
     }
     
     return false;
 }
 
-bool UrlQueue::empty() const {
+void UrlQueue::release(const std::string& url) {
+    std::string host = hostKey(normalizeUrl(url));
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    auto it = hosts_.find(host);
+    if (it == hosts_.end()) {
+        return;
+    }
+    
+    HostState& state = it->second;
+    if (state.active > 0) {
+        state.active--;
+    }
+    
+    if (state.pending.empty() && state.active == 0 &&
+        state.next_ready <= std::chrono::steady_clock::now()) {
+        // Nothing left to remember about this host
+        hosts_.erase(it);
+        return;
+    }
+    
+    scheduleHost(host, state);
+}
+
+void UrlQueue::retryLater(UrlQueueItem item, std::chrono::milliseconds delay) {
+    std::string host = hostKey(item.url);
+    
     std::lock_guard<std::mutex> lock(mutex_);
-    return queue_.empty();
+    
+    HostState& state = hosts_[host];
+    if (state.active > 0) {
+        state.active--;
+    }
+    state.next_ready = std::max(state.next_ready, std::chrono::steady_clock::now() + delay);
+    state.pending.push_front(std::move(item));
+    pending_count_++;
+    scheduleHost(host, state);
+}
+
+bool UrlQueue::empty() const {
+    return getPendingCount() == 0;
 }
 
 size_t UrlQueue::size() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return queue_.size();
+    return getPendingCount();
 }
 
 void UrlQueue::stop() {
@@ -69,51 +249,114 @@ void UrlQueue::stop() {
 }
 
 bool UrlQueue::isProcessed(const std::string& url) const {
-    std::string normalized_url = normalizeUrl(url);
-    std::lock_guard<std::mutex> lock(mutex_);
-    return processed_urls_.count(normalized_url) > 0;
+    std::string key = seenKey(normalizeUrl(url));
+    const SeenShard& shard = shardFor(key);
+    
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.urls->isProcessed(key);
 }
 
 void UrlQueue::markProcessed(const std::string& url) {
     std::string normalized_url = normalizeUrl(url);
-    std::lock_guard<std::mutex> lock(mutex_);
-    processed_urls_.insert(normalized_url);
+    std::string key = seenKey(normalized_url);
+    SeenShard& shard = shardFor(key);
+    
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (!shard.urls->markProcessed(key)) {
+            return;
+        }
+    }
+    
+    processed_count_++;
+    if (CrawlJournal* journal = journal_.load()) {
+        journal->recordProcessed(normalized_url);
+    }
+}
+
+size_t UrlQueue::getSeenSetMemoryUsage() const {
+    size_t total = 0;
+    for (const SeenShard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.urls->memoryUsage();
+    }
+    return total;
 }
 
 size_t UrlQueue::getProcessedCount() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return processed_urls_.size();
+    return processed_count_.load();
 }
 
 size_t UrlQueue::getPendingCount() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    return queue_.size();
+    return pending_count_ + (spill_ ? spill_->size() : 0);
 }
 
 std::string UrlQueue::normalizeUrl(const std::string& url) const {
-    std::string Normalized = url;
-    if (Normalized.length() > 1 && Normalized.back() == '/')
-    {
-        Normalized.pop_back();
+    std::string normalized;
+    if (!canonicalizeUrl(url, normalized)) {
+        // Not an absolute URL; keep it as given
+        return url;
     }
+    return normalized;
+}
 
-    size_t PathStartPose = Normalized.find("://");
-    if (PathStartPose != std::string::npos)
-    {
-        PathStartPose = Normalized.find('/', PathStartPose + 3);
+std::string UrlQueue::seenKey(const std::string& normalized_url) {
+    // "/dir/" and "/dir" are nearly always the same page (one redirects to
+    // the other), so they share a key without trailing slashes. Only the
+    // key drops them: relative links on "/dir/" resolve below it.
+    size_t scheme_end = normalized_url.find("://");
+    if (scheme_end == std::string::npos) {
+        return normalized_url;
     }
-    else
-    {
-        return Normalized;
+    size_t path_start = normalized_url.find('/', scheme_end + 3);
+    if (path_start == std::string::npos || normalized_url.find('?', path_start) != std::string::npos) {
+        return normalized_url;
+    }
+    size_t end = normalized_url.size();
+    while (end > path_start + 1 && normalized_url[end - 1] == '/') {
+        --end;
     }
+    return normalized_url.substr(0, end);
+}
 
-    if (PathStartPose == std::string::npos)
-    {
-        std::transform(Normalized.begin(), Normalized.end(), Normalized.begin(), [](unsigned char C) { return std::tolower(C); });
+UrlQueue::SeenShard& UrlQueue::shardFor(const std::string& key) {
+    return shards_[std::hash<std::string>()(key) % SHARD_COUNT];
+}
+
+const UrlQueue::SeenShard& UrlQueue::shardFor(const std::string& key) const {
+    return shards_[std::hash<std::string>()(key) % SHARD_COUNT];
+}
+
+std::string UrlQueue::hostKey(const std::string& url) {
+    size_t host_start = url.find("://");
+    if (host_start == std::string::npos) {
+        return "";
     }
-    else
-    {
-        std::transform(Normalized.begin(), Normalized.begin() + PathStartPose, Normalized.begin(), [](unsigned char C) { return std::tolower(C); });
+    host_start += 3;
+    
+    size_t host_end = url.find_first_of("/?#", host_start);
+    if (host_end == std::string::npos) {
+        host_end = url.length();
+    }
+    
+    return url.substr(host_start, host_end - host_start);
+}
+
+std::chrono::milliseconds UrlQueue::crawlDelayFor(const std::string& host) const {
+    auto it = host_crawl_delays_.find(host);
+    if (it == host_crawl_delays_.end()) {
+        return crawl_delay_;
     }
-    return Normalized;
-}
\ No newline at end of file
+    return std::max(crawl_delay_, it->second);
+}
+
+void UrlQueue::scheduleHost(const std::string& host, HostState& state) {
+    if (state.scheduled || state.pending.empty() || state.active >= max_active_per_host_) {
+        return;
+    }
+    
+    state.scheduled = true;
+    ready_hosts_.emplace(state.next_ready, host);
+    condition_.notify_one();
+}
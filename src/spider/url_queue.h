@@ -1,11 +1,19 @@
 #pragma once
 
 #include <string>
+#include <deque>
 #include <queue>
-#include <unordered_set>
+#include <vector>
+#include <unordered_map>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include "spill_queue.h"
+#include "seen_set.h"
+
+class CrawlJournal;
 
 struct UrlQueueItem {
     std::string url;
@@ -14,17 +22,57 @@ struct UrlQueueItem {
     UrlQueueItem(const std::string& u, int d) : url(u), depth(d) {}
 };
 
+// URL frontier with per-host politeness. Pending URLs are grouped by host;
+// dequeue() only hands out a URL whose host has waited out its crawl delay
+// and has fewer than the allowed number of fetches in progress.
+//
+// At most a configured number of pending URLs are held in memory; beyond
+// that the tail of the frontier spills to segment files on disk and is
+// read back as the in-memory head drains.
+//
+// The set of seen URLs is split into lock-striped shards by URL hash, so
+// duplicate checks from many threads rarely contend; the scheduler has its
+// own lock, taken once per enqueue batch.
 class UrlQueue {
 public:
     UrlQueue();
     ~UrlQueue();
     
-    // Add URL to queue if not already processed
+    // Set the minimum delay between fetch starts and the maximum number of
+    // concurrent fetches for any single host
+    void setPoliteness(std::chrono::milliseconds crawl_delay, int max_active_per_host);
+    
+    // Use a longer crawl delay for the host of url (e.g. from robots.txt)
+    void setHostCrawlDelay(const std::string& url, std::chrono::milliseconds crawl_delay);
+    
+    // Choose how seen URLs are stored (call before queueing anything)
+    void setSeenSetOptions(const SeenSetOptions& options);
+    
+    // Record newly queued and processed URLs in journal (null to stop)
+    void setJournal(CrawlJournal* journal);
+    
+    // Keep at most memory_items pending URLs in memory and spill the rest
+    // to segment files in directory
+    void enableSpill(const std::string& directory, size_t memory_items);
+    
+    // Add URL to queue if not already queued or processed
     bool enqueue(const std::string& url, int depth);
     
-    // Get next URL from queue (blocks if empty)
+    // Add several URLs at once, taking each shard lock at most once.
+    // Returns the number queued; accepted (if given) receives their normalized forms.
+    size_t enqueueMany(const std::vector<std::string>& urls, int depth,
+                       std::vector<std::string>* accepted = nullptr);
+    
+    // Get next URL whose host is ready (blocks until one is)
     bool dequeue(UrlQueueItem& item);
     
+    // Report that the fetch of a dequeued URL has finished
+    void release(const std::string& url);
+    
+    // Instead of release(): put a dequeued URL back at the head of its
+    // host's queue and hand out nothing from that host for delay
+    void retryLater(UrlQueueItem item, std::chrono::milliseconds delay);
+    
     // Check if queue is empty
     bool empty() const;
     
@@ -44,14 +92,76 @@ public:
     size_t getProcessedCount() const;
     size_t getPendingCount() const;
     
+    // Approximate memory used by the seen-URL set
+    size_t getSeenSetMemoryUsage() const;
+    
 private:
-    std::queue<UrlQueueItem> queue_;
-    std::unordered_set<std::string> processed_urls_;
-    std::unordered_set<std::string> queued_urls_;
+    struct HostState {
+        std::deque<UrlQueueItem> pending;
+        std::chrono::steady_clock::time_point next_ready;
+        int active = 0;
+        bool scheduled = false;   // has an entry in ready_hosts_
+    };
+    
+    using ReadyEntry = std::pair<std::chrono::steady_clock::time_point, std::string>;
+    
+    std::unordered_map<std::string, HostState> hosts_;
+    
+    // Hosts with pending URLs and a free fetch slot, earliest ready time first
+    std::priority_queue<ReadyEntry, std::vector<ReadyEntry>, std::greater<ReadyEntry>> ready_hosts_;
+    size_t pending_count_;   // pending URLs held in memory
+    std::chrono::milliseconds crawl_delay_;
+    int max_active_per_host_;
     
+    // Hosts whose crawl delay exceeds crawl_delay_; kept after their HostState is dropped
+    std::unordered_map<std::string, std::chrono::milliseconds> host_crawl_delays_;
+    
+    // Disk tail of the frontier (null when spilling is disabled)
+    std::unique_ptr<SpillQueue> spill_;
+    size_t memory_limit_;
+    
+    // Seen URLs with their processed flags
+    struct alignas(64) SeenShard {
+        mutable std::mutex mutex;
+        std::unique_ptr<SeenSet> urls;
+    };
+    
+    static const size_t SHARD_COUNT = 64;
+    SeenShard shards_[SHARD_COUNT];
+    std::atomic<size_t> processed_count_;
+    
+    std::atomic<CrawlJournal*> journal_;
+    
+    // Guards the scheduler state above
     mutable std::mutex mutex_;
     std::condition_variable condition_;
     std::atomic<bool> stopped_;
     
+    // Canonical form that is queued, scheduled and fetched (see canonicalizeUrl)
     std::string normalizeUrl(const std::string& url) const;
+    
+    // Seen-set key of a normalized URL, which may be coarser than the URL
+    static std::string seenKey(const std::string& normalized_url);
+    
+    SeenShard& shardFor(const std::string& key);
+    const SeenShard& shardFor(const std::string& key) const;
+    
+    // Add already de-duplicated URLs to the scheduler
+    void schedule(std::vector<UrlQueueItem>& items);
+    
+    // Add one URL to its host's in-memory queue; caller holds mutex_
+    void addPending(UrlQueueItem item);
+    
+    // Move spilled URLs back into memory once the head runs low; caller
+    // holds lock, which may be released while waiting for disk
+    void refillFromSpill(std::unique_lock<std::mutex>& lock);
+    
+    // Host part (host[:port]) of a normalized URL
+    static std::string hostKey(const std::string& url);
+    
+    // Delay between fetch starts for host; caller holds mutex_
+    std::chrono::milliseconds crawlDelayFor(const std::string& host) const;
+    
+    // Put host in ready_hosts_ if it has work and a free slot; caller holds mutex_
+    void scheduleHost(const std::string& host, HostState& state);
 };
\ No newline at end of file
@@ -0,0 +1,300 @@
+#include "warc.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+#include <zlib.h>
+
+namespace {
+
+// Line and block reader over a gzFile (which also reads plain files),
+// tracking the offset in the uncompressed stream
+class GzReader {
+public:
+    explicit GzReader(gzFile file) : file_(file), pos_(0), offset_(0), eof_(false) {}
+
+    bool readLine(std::string& line) {
+        line.clear();
+        while (true) {
+            size_t newline = buffer_.find('\n', pos_);
+            if (newline != std::string::npos) {
+                line.append(buffer_, pos_, newline - pos_);
+                consume(newline + 1 - pos_);
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                return true;
+            }
+            line.append(buffer_, pos_, std::string::npos);
+            consume(buffer_.size() - pos_);
+            if (!fill()) {
+                return !line.empty();
+            }
+        }
+    }
+
+    // Read length bytes into out, or skip them when out is null
+    bool read(uint64_t length, std::string* out) {
+        while (length > 0) {
+            if (pos_ == buffer_.size() && !fill()) {
+                return false;
+            }
+            size_t take = static_cast<size_t>(std::min<uint64_t>(length, buffer_.size() - pos_));
+            if (out) {
+                out->append(buffer_, pos_, take);
+            }
+            consume(take);
+            length -= take;
+        }
+        return true;
+    }
+
+    uint64_t offset() const { return offset_; }
+
+private:
+    gzFile file_;
+    std::string buffer_;
+    size_t pos_;
+    uint64_t offset_;
+    bool eof_;
+
+    void consume(size_t count) {
+        pos_ += count;
+        offset_ += count;
+    }
+
+    bool fill() {
+        if (eof_) {
+            return false;
+        }
+        char chunk[64 * 1024];
+        int read = gzread(file_, chunk, sizeof(chunk));
+        if (read <= 0) {
+            eof_ = true;
+            return false;
+        }
+        buffer_.assign(chunk, static_cast<size_t>(read));
+        pos_ = 0;
+        return true;
+    }
+};
+
+std::string currentWarcDate() {
+    std::time_t now = std::time(nullptr);
+    std::tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &now);
+#else
+    gmtime_r(&now, &utc);
+#endif
+    char date[32];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    return date;
+}
+
+}
+
+WarcWriter::WarcWriter(const std::string& path)
+    : path_(path)
+    , records_(0)
+    , random_(std::random_device{}()) {
+}
+
+WarcWriter::~WarcWriter() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_.is_open()) {
+        file_.close();
+    }
+}
+
+bool WarcWriter::open() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_.open(path_, std::ios::binary | std::ios::trunc);
+        if (!file_) {
+            return false;
+        }
+    }
+
+    return writeRecord("warcinfo", "", "application/warc-fields",
+                       "software: SearchEngine-Spider/1.0\r\nformat: WARC File Format 1.0\r\n");
+}
+
+bool WarcWriter::writeResponse(const std::string& url, const std::string& http_message) {
+    return writeRecord("response", url, "application/http; msgtype=response", http_message);
+}
+
+size_t WarcWriter::getRecordCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_;
+}
+
+bool WarcWriter::writeRecord(const std::string& type, const std::string& url,
+                             const std::string& content_type, const std::string& content) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!file_.is_open()) {
+        return false;
+    }
+
+    // Random (version 4) UUID for WARC-Record-ID
+    uint64_t high = random_();
+    uint64_t low = random_();
+    high = (high & 0xffffffffffff0fffULL) | 0x0000000000004000ULL;
+    low = (low & 0x3fffffffffffffffULL) | 0x8000000000000000ULL;
+    char record_id[64];
+    std::snprintf(record_id, sizeof(record_id), "<urn:uuid:%08x-%04x-%04x-%04x-%012llx>",
+                  static_cast<unsigned>(high >> 32), static_cast<unsigned>((high >> 16) & 0xffff),
+                  static_cast<unsigned>(high & 0xffff), static_cast<unsigned>(low >> 48),
+                  static_cast<unsigned long long>(low & 0xffffffffffffULL));
+
+    file_ << "WARC/1.0\r\n"
+          << "WARC-Type: " << type << "\r\n"
+          << "WARC-Record-ID: " << record_id << "\r\n"
+          << "WARC-Date: " << currentWarcDate() << "\r\n";
+    if (!url.empty()) {
+        file_ << "WARC-Target-URI: " << url << "\r\n";
+    }
+    file_ << "Content-Type: " << content_type << "\r\n"
+          << "Content-Length: " << content.size() << "\r\n"
+          << "\r\n";
+    file_.write(content.data(), static_cast<std::streamsize>(content.size()));
+    file_ << "\r\n\r\n";
+    file_.flush();
+
+    if (!file_) {
+        return false;
+    }
+    records_++;
+    return true;
+}
+
+WarcArchive::WarcArchive(const std::string& path)
+    : path_(path)
+    , compressed_(false) {
+}
+
+WarcArchive::~WarcArchive() {
+}
+
+bool WarcArchive::open() {
+    gzFile gz = gzopen(path_.c_str(), "rb");
+    if (!gz) {
+        error_ = "cannot open " + path_;
+        return false;
+    }
+    compressed_ = !gzdirect(gz);
+
+    GzReader reader(gz);
+    std::string line;
+    bool ok = true;
+
+    while (true) {
+        // Records are separated by blank lines
+        bool have_line = false;
+        while ((have_line = reader.readLine(line)) && line.empty()) {
+        }
+        if (!have_line) {
+            break;
+        }
+
+        if (line.compare(0, 5, "WARC/") != 0) {
+            error_ = "not a WARC record at offset " + std::to_string(reader.offset());
+            ok = false;
+            break;
+        }
+
+        std::string type;
+        std::string uri;
+        uint64_t length = 0;
+        while (reader.readLine(line) && !line.empty()) {
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) {
+                continue;
+            }
+            std::string name = line.substr(0, colon);
+            std::transform(name.begin(), name.end(), name.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            size_t value_start = line.find_first_not_of(" \t", colon + 1);
+            std::string value = value_start == std::string::npos ? "" : line.substr(value_start);
+
+            if (name == "warc-type") {
+                type = value;
+            } else if (name == "warc-target-uri") {
+                // Older writers wrap the URI in angle brackets
+                if (value.size() >= 2 && value.front() == '<' && value.back() == '>') {
+                    value = value.substr(1, value.size() - 2);
+                }
+                uri = value;
+            } else if (name == "content-length") {
+                try {
+                    length = std::stoull(value);
+                } catch (const std::exception&) {
+                    length = 0;
+                }
+            }
+        }
+
+        Record record;
+        record.offset = reader.offset();
+        record.length = length;
+
+        bool keep = (type == "response" && !uri.empty());
+        if (!reader.read(length, keep && compressed_ ? &record.data : nullptr)) {
+            error_ = "truncated record for " + (uri.empty() ? type : uri);
+            ok = false;
+            break;
+        }
+        if (keep) {
+            records_[uri] = std::move(record);
+        }
+    }
+
+    gzclose(gz);
+
+    if (!ok) {
+        return false;
+    }
+
+    if (!compressed_) {
+        file_.open(path_, std::ios::binary);
+        if (!file_) {
+            error_ = "cannot open " + path_;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WarcArchive::find(const std::string& url, std::string& http_message) const {
+    auto it = records_.find(url);
+    if (it == records_.end()) {
+        return false;
+    }
+
+    const Record& record = it->second;
+    if (compressed_) {
+        http_message = record.data;
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    http_message.resize(static_cast<size_t>(record.length));
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(record.offset));
+    file_.read(&http_message[0], static_cast<std::streamsize>(record.length));
+    return static_cast<bool>(file_);
+}
+
+size_t WarcArchive::size() const {
+    return records_.size();
+}
+
+std::vector<std::string> WarcArchive::getUrls() const {
+    std::vector<std::string> urls;
+    urls.reserve(records_.size());
+    for (const auto& record : records_) {
+        urls.push_back(record.first);
+    }
+    return urls;
+}
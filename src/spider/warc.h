@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <memory>
+#include <random>
+#include <cstdint>
+#include <unordered_map>
+
+// Writes fetched responses to a WARC file (ISO 28500, WARC/1.0) as
+// "response" records. The HTTP message stored is rebuilt from the decoded
+// response, so it has no Content-Encoding or chunking and its
+// Content-Length matches the body; replaying it gives the same page.
+class WarcWriter {
+public:
+    explicit WarcWriter(const std::string& path);
+    ~WarcWriter();
+
+    WarcWriter(const WarcWriter&) = delete;
+    WarcWriter& operator=(const WarcWriter&) = delete;
+
+    // Create the file, replacing any existing one, and write a warcinfo record
+    bool open();
+
+    // Append one response record for url; http_message is the complete
+    // HTTP response (status line, headers, blank line, body)
+    bool writeResponse(const std::string& url, const std::string& http_message);
+
+    size_t getRecordCount() const;
+
+    const std::string& getPath() const { return path_; }
+
+private:
+    std::string path_;
+    std::ofstream file_;
+    size_t records_;
+    std::mt19937_64 random_;   // for record IDs
+    mutable std::mutex mutex_;
+
+    bool writeRecord(const std::string& type, const std::string& url,
+                     const std::string& content_type, const std::string& content);
+};
+
+// Read-only index of the response records in a WARC file, plain or
+// gzip-compressed (one member per record or the whole file). Records are
+// located by target URI; the last record for a URI wins. Plain files are
+// read on demand; compressed ones are decompressed once and the HTTP
+// messages kept in memory.
+class WarcArchive {
+public:
+    explicit WarcArchive(const std::string& path);
+    ~WarcArchive();
+
+    WarcArchive(const WarcArchive&) = delete;
+    WarcArchive& operator=(const WarcArchive&) = delete;
+
+    // Scan the file and build the index
+    bool open();
+
+    // Get the HTTP response message stored for url; false if there is none
+    bool find(const std::string& url, std::string& http_message) const;
+
+    size_t size() const;
+
+    // Target URIs of all response records
+    std::vector<std::string> getUrls() const;
+
+    const std::string& getPath() const { return path_; }
+    const std::string& getError() const { return error_; }
+
+private:
+    struct Record {
+        uint64_t offset;     // start of the HTTP message (plain files)
+        uint64_t length;
+        std::string data;    // the HTTP message (compressed files)
+    };
+
+    std::string path_;
+    std::string error_;
+    bool compressed_;
+    std::unordered_map<std::string, Record> records_;
+
+    // Plain files are read through one stream shared by all lookups
+    mutable std::ifstream file_;
+    mutable std::mutex mutex_;
+};